@@ -0,0 +1,666 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <findlink/byte_string.h>
+#include <findlink/target_matcher.h>
+#include <findlink/target_set.h>
+
+/**
+ * @brief       Print usage.
+ *
+ * @param[in]   name        Command name.
+ */
+void usage(const char *name)
+{
+    printf("Usage:\n"
+           "    %s [OPTIONS]\n"
+           "    %s -h\n"
+           "\n"
+           "Generate synthetic trees and time findlink on them, or time\n"
+           "target matching in process with --matchers.\n"
+           "\n"
+           "Optional Arguments:\n"
+           "    -h, --help           Show this help.\n"
+           "    --root DIR           Directory to create the temporary\n"
+           "                         directory trees are generated in.\n"
+           "                         Default is \"/tmp\".\n"
+           "    --scale SCALE        Scale of trees. Default is 1.\n"
+           "    --threads LIST       Comma separated thread counts.\n"
+           "                         Default is \"1,2,4,8\".\n"
+           "    --engines LIST       Comma separated engines. Default is\n"
+           "                         \"threads,uring\".\n"
+           "    --repeat COUNT       Runs of each case, the fastest is\n"
+           "                         reported. Default is 3.\n"
+           "    --findlink PATH      findlink to run. Default is the one\n"
+           "                         built with the benchmark.\n"
+           "    --keep               Keep generated trees.\n"
+           "    --csv FILE           Append results to FILE as CSV, to\n"
+           "                         track them across builds.\n"
+           "    --label LABEL        Label of results in CSV. Default is\n"
+           "                         the build profile, \"%s\".\n"
+           "    --matchers           Time matchers on generated paths with\n"
+           "                         each instruction set supported instead\n"
+           "                         of running findlink.\n",
+           name, name, FINDLINK_BUILD_PROFILE);
+}
+
+/**
+ * @brief       Benchmark options.
+ */
+struct BenchOptions {
+    ::std::filesystem::path      root;                 ///< Root of trees.
+    unsigned int                 scale  = 1;           ///< Scale of trees.
+    ::std::vector<unsigned int>  threads = {1, 2, 4, 8}; ///< Thread counts.
+    ::std::vector<::std::string> engines = {"threads", "uring"}; ///< Engines.
+    unsigned int                 repeat = 3;           ///< Runs of each case.
+    ::std::string                findlink = FINDLINK_PATH; ///< findlink.
+    bool                         keep   = false;       ///< Keep trees.
+    bool                         matchers = false;     ///< Time matchers.
+    ::std::string                csv;                  ///< CSV to append to.
+
+    /// Label of results in CSV.
+    ::std::string label = FINDLINK_BUILD_PROFILE;
+};
+
+/**
+ * @brief       Synthetic tree.
+ */
+struct Scenario {
+    ::std::string           name;   ///< Name.
+    ::std::filesystem::path dir;    ///< Directory to search.
+    ::std::filesystem::path target; ///< Target to search.
+};
+
+/**
+ * @brief       Split comma separated list.
+ *
+ * @param[in]   str         String.
+ *
+ * @return      Items.
+ */
+::std::vector<::std::string> splitList(const char *str)
+{
+    ::std::vector<::std::string> ret;
+    ::std::string                item;
+    for (auto p = str;; ++p) {
+        if (*p == ',' || *p == '\0') {
+            if (! item.empty()) {
+                ret.push_back(::std::move(item));
+            }
+            item.clear();
+            if (*p == '\0') {
+                break;
+            }
+        } else {
+            item.push_back(*p);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Create regular file.
+ *
+ * @param[in]   path        Path.
+ */
+void makeFile(const ::std::filesystem::path &path)
+{
+    ::std::ofstream stream(path);
+}
+
+/**
+ * @brief       Generate deep and narrow tree, chains of nested directories
+ *              each holding a file and a relative link to the target.
+ *
+ * @param[in]   root        Root of trees.
+ * @param[in]   scale       Scale.
+ *
+ * @return      Scenario.
+ */
+Scenario generateDeep(const ::std::filesystem::path &root, unsigned int scale)
+{
+    constexpr unsigned int DEPTH = 200;
+
+    Scenario ret = {"deep", root / "deep", root / "deep" / "target"};
+    ::std::filesystem::create_directories(ret.target);
+    for (unsigned int chain = 0; chain < 16 * scale; ++chain) {
+        auto        dir = ret.dir / ("c" + ::std::to_string(chain));
+        ::std::string up = "../target";
+        for (unsigned int depth = 0; depth < DEPTH; ++depth) {
+            ::std::filesystem::create_directory(dir);
+            makeFile(dir / "f");
+            ::std::filesystem::create_symlink(up, dir / "l");
+            dir /= "d";
+            up = "../" + up;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Generate wide and shallow tree, many sibling directories each
+ *              holding a file and an absolute link to the target.
+ *
+ * @param[in]   root        Root of trees.
+ * @param[in]   scale       Scale.
+ *
+ * @return      Scenario.
+ */
+Scenario generateWide(const ::std::filesystem::path &root, unsigned int scale)
+{
+    Scenario ret = {"wide", root / "wide", root / "wide" / "target"};
+    ::std::filesystem::create_directories(ret.target);
+    for (unsigned int i = 0; i < 20000 * scale; ++i) {
+        auto dir = ret.dir / ("d" + ::std::to_string(i));
+        ::std::filesystem::create_directory(dir);
+        makeFile(dir / "f");
+        ::std::filesystem::create_symlink(ret.target, dir / "l");
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Generate link heavy tree, relative, absolute and broken links
+ *              and link chains mixed in random order.
+ *
+ * @param[in]   root        Root of trees.
+ * @param[in]   scale       Scale.
+ *
+ * @return      Scenario.
+ */
+Scenario generateLinks(const ::std::filesystem::path &root, unsigned int scale)
+{
+    constexpr unsigned int DIRS    = 64;
+    constexpr unsigned int ENTRIES = 256;
+    constexpr unsigned int CHAIN   = 8;
+
+    Scenario ret = {"links", root / "links", root / "links" / "target"};
+    ::std::filesystem::create_directories(ret.target / "sub");
+
+    // Fixed seed, the same tree for every run.
+    ::std::mt19937 random(20240101);
+    for (unsigned int i = 0; i < DIRS * scale; ++i) {
+        auto dir = ret.dir / ("d" + ::std::to_string(i));
+        ::std::filesystem::create_directory(dir);
+        for (unsigned int j = 0; j < ENTRIES; ++j) {
+            auto name = "e" + ::std::to_string(j);
+            switch (random() % 5) {
+                case 0:
+                    ::std::filesystem::create_symlink("../target", dir / name);
+                    break;
+
+                case 1:
+                    ::std::filesystem::create_symlink(ret.target / "sub",
+                                                      dir / name);
+                    break;
+
+                case 2:
+                    ::std::filesystem::create_symlink("../missing/" + name,
+                                                      dir / name);
+                    break;
+
+                case 3: {
+                    // Chain of links ending at the target.
+                    ::std::string previous = "../target";
+                    for (unsigned int k = 0; k < CHAIN; ++k) {
+                        auto link = name + "_" + ::std::to_string(k);
+                        ::std::filesystem::create_symlink(previous,
+                                                          dir / link);
+                        previous = link;
+                    }
+                } break;
+
+                default:
+                    makeFile(dir / name);
+                    break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Run findlink.
+ *
+ * @param[in]   args        Arguments, without command.
+ * @param[in]   options     Benchmark options.
+ *
+ * @return      Seconds elapsed, negative on failure.
+ */
+double runFindlink(const ::std::vector<::std::string> &args,
+                   const BenchOptions                 &options)
+{
+    ::std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(options.findlink.c_str()));
+    for (auto &arg : args) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    auto  begin = ::std::chrono::steady_clock::now();
+    pid_t pid   = ::fork();
+    if (pid < 0) {
+        return -1;
+    } else if (pid == 0) {
+        int fd = ::open("/dev/null", O_WRONLY);
+        ::dup2(fd, STDOUT_FILENO);
+        ::dup2(fd, STDERR_FILENO);
+        ::execv(argv[0], argv.data());
+        ::_exit(127);
+    }
+
+    int status;
+    if (::waitpid(pid, &status, 0) < 0 || ! WIFEXITED(status)
+        || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+
+    return ::std::chrono::duration<double>(::std::chrono::steady_clock::now()
+                                          - begin)
+        .count();
+}
+
+/**
+ * @brief       Load metrics exported by findlink.
+ *
+ * @param[in]   path        Path of metrics file.
+ *
+ * @return      Metrics by name.
+ */
+::std::map<::std::string, double> loadStats(const ::std::filesystem::path &path)
+{
+    ::std::map<::std::string, double> ret;
+    ::std::ifstream                   stream(path);
+    ::std::string                     name;
+    double                            value;
+    while (stream >> name >> value) {
+        ret[name] = value;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Time each case of a scenario and print results.
+ *
+ * @param[in]   scenario    Scenario.
+ * @param[in]   options     Benchmark options.
+ * @param[out]  csv         CSV to append results to, if open.
+ *
+ * @return      \c true on success, \c false if a run failed.
+ */
+bool benchScenario(const Scenario     &scenario,
+                   const BenchOptions &options,
+                   ::std::ofstream    &csv)
+{
+    auto statsPath = options.root / "stats.txt";
+    for (auto &engine : options.engines) {
+        for (auto threads : options.threads) {
+            // The uring engine runs on a single thread.
+            if (engine == "uring" && threads != options.threads.front()) {
+                continue;
+            }
+
+            ::std::vector<::std::string> args
+                = {"--stats-file",  statsPath.native(),
+                   "--engine",      engine,
+                   "-j",            ::std::to_string(threads),
+                   "--under",       scenario.target.native(),
+                   scenario.dir.native()};
+            double best = -1;
+            for (unsigned int i = 0; i < options.repeat; ++i) {
+                auto seconds = runFindlink(args, options);
+                if (seconds < 0) {
+                    fprintf(stderr, "Failed to run \"%s\".\n",
+                            options.findlink.c_str());
+                    return false;
+                }
+                if (best < 0 || seconds < best) {
+                    best = seconds;
+                }
+            }
+
+            auto stats = loadStats(statsPath);
+            printf("%-8s %-8s %8s %10.4f %14.0f %14.0f\n",
+                   scenario.name.c_str(), engine.c_str(),
+                   engine == "uring" ? "-" : ::std::to_string(threads).c_str(),
+                   best, stats["entries_seen"] / best,
+                   stats["links_read"] / best);
+            if (csv.is_open()) {
+                csv << ::std::time(nullptr) << ',' << options.label << ','
+                    << options.scale << ',' << scenario.name << ',' << engine
+                    << ',' << threads << ',' << best << ','
+                    << stats["entries_seen"] / best << ','
+                    << stats["links_read"] / best << '\n';
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief       Generate paths of realistic lengths, like those of installed
+ *              packages.
+ *
+ * @param[in]   count       Number of paths.
+ *
+ * @return      Paths.
+ */
+::std::vector<::std::string> generatePaths(::std::size_t count)
+{
+    static const char *const ROOTS[] = {"/usr/lib/x86_64-linux-gnu",
+                                        "/usr/share/doc", "/opt", "/etc",
+                                        "/usr/local/lib/python3.11"};
+    static const char *const WORDS[] = {
+        "alternatives", "site-packages", "include", "share",  "bin",
+        "libexec",      "versions",      "current", "locale", "man",
+        "config",       "plugins",       "modules", "lib64",  "gcc"};
+
+    // Fixed seed, the same paths for every run.
+    ::std::mt19937               random(20240101);
+    ::std::vector<::std::string> ret;
+    for (::std::size_t i = 0; i < count; ++i) {
+        ::std::string path = ROOTS[random() % ::std::size(ROOTS)];
+        auto          depth = 1 + random() % 6;
+        for (unsigned int j = 0; j < depth; ++j) {
+            path.push_back('/');
+            path.append(WORDS[random() % ::std::size(WORDS)]);
+            if (random() % 3 == 0) {
+                path.append("-" + ::std::to_string(random() % 100));
+            }
+        }
+        ret.push_back(::std::move(path));
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Time a matcher over paths.
+ *
+ * @param[in]   matcher     Matcher.
+ * @param[in]   paths       Paths.
+ * @param[in]   repeat      Runs, the fastest is returned.
+ * @param[out]  matched     Number of paths matched.
+ *
+ * @return      Seconds of the fastest run.
+ */
+template<typename Matcher>
+double timeMatcher(const Matcher                      &matcher,
+                   const ::std::vector<::std::string> &paths,
+                   unsigned int                        repeat,
+                   ::std::size_t                      &matched)
+{
+    double best = -1;
+    for (unsigned int i = 0; i < repeat; ++i) {
+        matched    = 0;
+        auto begin = ::std::chrono::steady_clock::now();
+        for (auto &path : paths) {
+            matched += (matcher(path) != nullptr);
+        }
+        auto seconds = ::std::chrono::duration<double>(
+                           ::std::chrono::steady_clock::now() - begin)
+                           .count();
+        if (best < 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief       Time matchers with each instruction set supported and print
+ *              results.
+ *
+ * @param[in]   options     Benchmark options.
+ */
+void benchMatchers(const BenchOptions &options)
+{
+    constexpr ::std::size_t PATHS   = 1 << 20;
+    constexpr ::std::size_t TARGETS = 64;
+
+    auto paths = generatePaths(PATHS * options.scale);
+
+    // Targets are paths generated and their parents, a part of paths match.
+    ::std::vector<::std::string> targetPaths;
+    for (::std::size_t i = 0; i < TARGETS; ++i) {
+        auto &path = paths[i * 7919 % paths.size()];
+        targetPaths.push_back(i % 2 == 0 ? path
+                                         : path.substr(0, path.rfind('/')));
+    }
+
+    printf("%-8s %-10s %10s %14s %10s\n", "SIMD", "MATCHER", "SECONDS",
+           "LINKS/S", "MATCHED");
+    for (auto level :
+         {::findlink::SimdLevel::SCALAR, ::findlink::SimdLevel::SSE42,
+          ::findlink::SimdLevel::AVX2, ::findlink::SimdLevel::NEON}) {
+        if (! ::findlink::setSimdLevel(level)) {
+            continue;
+        }
+
+        // Hashes depend on the instruction set, fill sets after it is set.
+        ::findlink::TargetSet single;
+        ::findlink::TargetSet multiple;
+        single.add("/usr/lib/x86_64-linux-gnu/include");
+        for (auto &target : targetPaths) {
+            multiple.add(target);
+        }
+
+        auto report = [&](const char *name, const auto &matcher) -> void {
+            ::std::size_t matched = 0;
+            auto          seconds
+                = timeMatcher(matcher, paths, options.repeat, matched);
+            printf("%-8s %-10s %10.4f %14.0f %10zu\n",
+                   ::findlink::simdLevelName(level), name, seconds,
+                   static_cast<double>(paths.size()) / seconds, matched);
+        };
+        report("exact-1", ::findlink::SingleTargetMatcher(single));
+        report("under-1", ::findlink::SingleUnderMatcher(single));
+        report("exact-64", ::findlink::TargetSetMatcher(multiple));
+        report("under-64", ::findlink::TargetSetUnderMatcher(multiple));
+    }
+}
+
+/**
+ * @brief       Entery.
+ *
+ * @param[in]   argc        Count of arguments.
+ * @param[in]   argv        Values of arguments.
+ *
+ * @return      Exit code.
+ */
+int main(int argc, char *argv[])
+{
+    // Parse arguments.
+    enum LongOnlyOption {
+        OPT_ROOT = 0x100,
+        OPT_SCALE,
+        OPT_THREADS,
+        OPT_ENGINES,
+        OPT_REPEAT,
+        OPT_FINDLINK,
+        OPT_KEEP,
+        OPT_MATCHERS,
+        OPT_CSV,
+        OPT_LABEL,
+    };
+    struct option longOpts[] = {{"help", 0, nullptr, 'h'},
+                                {"root", 1, nullptr, OPT_ROOT},
+                                {"scale", 1, nullptr, OPT_SCALE},
+                                {"threads", 1, nullptr, OPT_THREADS},
+                                {"engines", 1, nullptr, OPT_ENGINES},
+                                {"repeat", 1, nullptr, OPT_REPEAT},
+                                {"findlink", 1, nullptr, OPT_FINDLINK},
+                                {"keep", 0, nullptr, OPT_KEEP},
+                                {"matchers", 0, nullptr, OPT_MATCHERS},
+                                {"csv", 1, nullptr, OPT_CSV},
+                                {"label", 1, nullptr, OPT_LABEL},
+                                {nullptr, 0, nullptr, 0}};
+
+    BenchOptions options;
+    int          opt;
+    while ((opt = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (opt) {
+            case 'h':
+                usage(argv[0]);
+                return 0;
+
+            case OPT_ROOT:
+                options.root = optarg;
+                break;
+
+            case OPT_SCALE:
+                options.scale = static_cast<unsigned int>(atoi(optarg));
+                if (options.scale == 0) {
+                    fprintf(stderr, "Illegal scale \"%s\".\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case OPT_THREADS:
+                options.threads.clear();
+                for (auto &item : splitList(optarg)) {
+                    auto threads = static_cast<unsigned int>(atoi(item.c_str()));
+                    if (threads == 0) {
+                        fprintf(stderr, "Illegal thread count \"%s\".\n",
+                                item.c_str());
+                        return 1;
+                    }
+                    options.threads.push_back(threads);
+                }
+                break;
+
+            case OPT_ENGINES:
+                options.engines = splitList(optarg);
+                break;
+
+            case OPT_REPEAT:
+                options.repeat = static_cast<unsigned int>(atoi(optarg));
+                if (options.repeat == 0) {
+                    fprintf(stderr, "Illegal repeat count \"%s\".\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case OPT_FINDLINK:
+                options.findlink = optarg;
+                break;
+
+            case OPT_KEEP:
+                options.keep = true;
+                break;
+
+            case OPT_MATCHERS:
+                options.matchers = true;
+                break;
+
+            case OPT_CSV:
+                options.csv = optarg;
+                break;
+
+            case OPT_LABEL:
+                options.label = optarg;
+                break;
+
+            default:
+                fprintf(stderr, "Unknow option.\n");
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (options.threads.empty() || options.engines.empty()) {
+        fprintf(stderr, "No case to run.\n");
+        return 1;
+    }
+    if (options.matchers) {
+        benchMatchers(options);
+        return 0;
+    }
+
+    // Results, header is written to a new file.
+    ::std::ofstream csv;
+    if (! options.csv.empty()) {
+        ::std::error_code ec;
+        bool exists = ::std::filesystem::exists(options.csv, ec);
+        csv.open(options.csv, ::std::ios::app);
+        if (! csv) {
+            fprintf(stderr, "Cannot open \"%s\".\n", options.csv.c_str());
+            return 1;
+        }
+        if (! exists) {
+            csv << "time,label,scale,tree,engine,threads,seconds,"
+                   "entries_per_second,links_per_second\n";
+        }
+    }
+
+    // Root of trees, always new so nothing existing is overwritten or
+    // removed.
+    if (options.root.empty()) {
+        options.root = "/tmp";
+    }
+    auto dir = (options.root / "findlink_bench.XXXXXX").native();
+    if (::mkdtemp(dir.data()) == nullptr) {
+        fprintf(stderr, "Cannot create temporary directory in \"%s\".\n",
+                options.root.c_str());
+        return 1;
+    }
+    options.root = ::std::filesystem::canonical(dir);
+
+    int ret = 0;
+    try {
+        // Generate.
+        ::std::vector<Scenario> scenarios;
+        for (auto generate : {generateDeep, generateWide, generateLinks}) {
+            auto begin = ::std::chrono::steady_clock::now();
+            scenarios.push_back(generate(options.root, options.scale));
+            fprintf(stderr, "Generated \"%s\" in %.2fs.\n",
+                    scenarios.back().name.c_str(),
+                    ::std::chrono::duration<double>(
+                        ::std::chrono::steady_clock::now() - begin)
+                        .count());
+        }
+
+        // Run.
+        printf("%-8s %-8s %8s %10s %14s %14s\n", "TREE", "ENGINE", "THREADS",
+               "SECONDS", "ENTRIES/S", "LINKS/S");
+        for (auto &scenario : scenarios) {
+            if (! benchScenario(scenario, options, csv)) {
+                ret = 1;
+                break;
+            }
+        }
+    } catch (::std::filesystem::filesystem_error &e) {
+        fprintf(stderr, "%s\n", e.what());
+        ret = 1;
+    }
+
+    // Clean.
+    if (options.keep) {
+        fprintf(stderr, "Trees are kept in \"%s\".\n", options.root.c_str());
+    } else {
+        ::std::error_code ec;
+        ::std::filesystem::remove_all(options.root, ec);
+    }
+
+    return ret;
+}
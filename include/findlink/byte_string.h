@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace findlink {
+
+/**
+ * @brief       Instruction sets of byte string functions.
+ */
+enum class SimdLevel {
+    SCALAR, ///< Portable code.
+    SSE42,  ///< SSE2 compare, SSE4.2 CRC32C hash.
+    AVX2,   ///< AVX2 compare, SSE4.2 CRC32C hash.
+    NEON,   ///< NEON compare.
+};
+
+/**
+ * @brief       Get instruction set used, the best one supported by the CPU
+ *              unless changed by \c setSimdLevel().
+ *
+ * @return      Instruction set.
+ */
+SimdLevel simdLevel();
+
+/**
+ * @brief       Use another instruction set.
+ *
+ * Hashes differ between instruction sets, so this must be called before
+ * any hash is stored, e.g. before any \c TargetSet is filled.
+ *
+ * @param[in]   level       Instruction set.
+ *
+ * @return      \c true on success, \c false if not supported by the CPU.
+ */
+bool setSimdLevel(SimdLevel level);
+
+/**
+ * @brief       Get name of instruction set.
+ *
+ * @param[in]   level       Instruction set.
+ *
+ * @return      Name.
+ */
+const char *simdLevelName(SimdLevel level);
+
+/**
+ * @brief       Compare bytes for equality.
+ *
+ * @param[in]   a           Bytes.
+ * @param[in]   b           Bytes.
+ * @param[in]   size        Size.
+ *
+ * @return      \c true if equal, \c false if not.
+ */
+bool bytesEqual(const char *a, const char *b, ::std::size_t size);
+
+/**
+ * @brief       Hash bytes.
+ *
+ * @param[in]   str         Bytes.
+ *
+ * @return      Hash.
+ */
+::std::size_t hashBytes(::std::string_view str);
+
+/**
+ * @brief       Check if two normalized paths are equal.
+ *
+ * @param[in]   a           Path.
+ * @param[in]   b           Path.
+ *
+ * @return      \c true if equal, \c false if not.
+ */
+inline bool pathEqual(::std::string_view a, ::std::string_view b)
+{
+    return a.size() == b.size() && bytesEqual(a.data(), b.data(), a.size());
+}
+
+/**
+ * @brief       Check if \c prefix is a component-wise prefix of \c path.
+ *
+ * @param[in]   path        Normalized path.
+ * @param[in]   prefix      Normalized prefix.
+ *
+ * @return      \c true if prefix, \c false if not.
+ */
+inline bool isPathPrefix(::std::string_view path, ::std::string_view prefix)
+{
+    return path.size() >= prefix.size()
+           && (path.size() == prefix.size() || path[prefix.size()] == '/'
+               || prefix.size() == 1)
+           && bytesEqual(path.data(), prefix.data(), prefix.size());
+}
+
+/**
+ * @brief       Transparent hash of paths by \c hashBytes().
+ */
+struct PathHash {
+    using is_transparent = void;
+
+    inline ::std::size_t operator()(::std::string_view str) const
+    {
+        return hashBytes(str);
+    }
+};
+
+/**
+ * @brief       Transparent equality of paths by \c pathEqual().
+ */
+struct PathEqual {
+    using is_transparent = void;
+
+    inline bool operator()(::std::string_view a, ::std::string_view b) const
+    {
+        return pathEqual(a, b);
+    }
+};
+
+} // namespace findlink
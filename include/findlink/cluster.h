@@ -0,0 +1,234 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <findlink/record_writer.h>
+#include <findlink/searcher.h>
+#include <findlink/visited_set.h>
+
+namespace findlink {
+
+/**
+ * @brief       Coordinator of a search split over workers on other hosts.
+ *
+ * The search directory must be mounted at the same path on every host.
+ * Each of its subdirectories is a work unit, links directly in it are
+ * resolved by the coordinator. Workers connect over TCP and send an 'A'
+ * record carrying the shared secret, then receive the targets once, then
+ * one unit at a time, and stream back what they find as records of the
+ * binary format of \c RecordWriter, followed by a 'D' record of size 0 when
+ * the unit is done. Hosts must share the byte order and the device numbers
+ * of the search directory.
+ *
+ * Trust model: a connection sending a wrong secret, or anything before the
+ * secret, is dropped before it sees targets or options, and only records
+ * of authenticated workers are reported. The secret and all traffic after
+ * it are sent in clear, so any host able to sniff the network can learn
+ * the secret, the targets and the links found, and impersonate a worker.
+ * Listen on an address of a trusted network, or tunnel the connections.
+ *
+ * Requests to a worker are a type byte and a payload ended by NUL, devices
+ * are decimal:
+ *
+ *     'T' target   canonical target
+ *     'G' glob     glob on canonical target
+ *     'X' pattern  exclude pattern
+ *     'F' type     filesystem type whose mount points are skipped
+ *     'R' dev      device of the search directory
+ *     'P' dev      device of a target, other devices are skipped
+ *     'O'          do not cross filesystems
+ *     'U'          match links under targets too
+ *     'V'          scan each directory once, within a unit
+ *     'K'          report each link once
+ *     'S' dir      search unit
+ *
+ * Links reported by different units are deduplicated by the coordinator.
+ *
+ * Records of a unit are held until it is done, so each unit is reported
+ * once. A unit whose worker disconnects is queued again, and when the queue
+ * is empty, idle workers take a copy of units still running elsewhere, the
+ * copy finished first wins. Closing the connection ends the worker, a copy
+ * still running when the connection is closed is dropped.
+ */
+class ClusterCoordinator {
+  public:
+    /// Link callback.
+    using LinkFunc = ::std::function<void(const RecordWriter::Link &)>;
+
+    /// Error callback, called with (path, errno, message).
+    using ErrorFunc = ::std::function<void(
+        ::std::string_view, int, ::std::string_view)>;
+
+  private:
+    /// Copies of a unit running at most.
+    static constexpr unsigned int MAX_COPIES = 2;
+
+    using Clock = ::std::chrono::steady_clock;
+
+    /**
+     * @brief       Work unit.
+     */
+    struct Unit {
+        ::std::string     dir;             ///< Directory.
+        unsigned int      running = 0;     ///< Copies running.
+        bool              done    = false; ///< Reported.
+        Clock::time_point started;         ///< Copy started first.
+    };
+
+    /**
+     * @brief       Connected worker.
+     */
+    struct Worker {
+        ::std::string received;      ///< Data received, not parsed yet.
+        ::std::string records;       ///< Records of current unit.
+        ::std::size_t unit;          ///< Current unit, \c NO_UNIT if idle.
+        bool          authenticated; ///< Secret checked.
+    };
+
+    /// Unit of an idle worker.
+    static constexpr ::std::size_t NO_UNIT = static_cast<::std::size_t>(-1);
+
+  private:
+    LinkFunc                    m_onLink;     ///< Link callback.
+    ErrorFunc                   m_onError;    ///< Error callback.
+    ::std::vector<Unit>         m_units;      ///< Units.
+    ::std::deque<::std::size_t> m_pending;    ///< Units never started.
+    ::std::size_t               m_left;       ///< Units not done.
+    ::std::string               m_hello;      ///< Requests sent at connect.
+    ::std::string               m_secret;     ///< Shared secret.
+    bool                        m_dedupLinks; ///< Report each link once.
+    VisitedLinkSet              m_links;      ///< Links reported.
+
+    /// Workers by socket.
+    ::std::unordered_map<int, Worker> m_workers;
+
+  public:
+    /**
+     * @brief       Constructor, report links directly in the search
+     *              directory and split its subdirectories into units.
+     *
+     * @param[in]   searcher    Searcher of targets and options.
+     * @param[in]   searchDir   Canonical directory to search.
+     * @param[in]   secret      Secret workers must send.
+     * @param[in]   onLink      Link callback.
+     * @param[in]   onError     Error callback.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    ClusterCoordinator(const Searcher                &searcher,
+                       const ::std::filesystem::path &searchDir,
+                       const ::std::string           &secret,
+                       const LinkFunc                &onLink,
+                       const ErrorFunc               &onError);
+
+    ClusterCoordinator(const ClusterCoordinator &)            = delete;
+    ClusterCoordinator &operator=(const ClusterCoordinator &) = delete;
+
+    /**
+     * @brief       Get number of units.
+     *
+     * @return      Number of units.
+     */
+    inline ::std::size_t unitCount() const
+    {
+        return m_units.size();
+    }
+
+    /**
+     * @brief       Listen on a TCP port and hand units to workers until all
+     *              are done.
+     *
+     * @param[in]   address     Address to listen on, empty for any.
+     * @param[in]   port        Port or service name.
+     *
+     * @throw       ::std::system_error
+     */
+    void run(const ::std::string &address, const ::std::string &port);
+
+  private:
+    /**
+     * @brief       Check the secret a worker sends first, then send it the
+     *              targets and options.
+     *
+     * @param[in]   fd          Socket of worker.
+     * @param[in]   worker      Worker.
+     *
+     * @return      \c true if authenticated or waiting for the secret,
+     *              \c false if the secret is wrong or the worker is gone.
+     */
+    bool authenticate(int fd, Worker &worker);
+
+    /**
+     * @brief       Give a unit to an idle worker.
+     *
+     * @param[in]   fd          Socket of worker.
+     * @param[in]   worker      Worker.
+     *
+     * @return      \c true on success, \c false if the worker is gone.
+     */
+    bool assign(int fd, Worker &worker);
+
+    /**
+     * @brief       Parse records received from a worker, the worker is idle
+     *              when its unit is done.
+     *
+     * @param[in]   worker      Worker.
+     */
+    void parse(Worker &worker);
+
+    /**
+     * @brief       Report records of a unit.
+     *
+     * @param[in]   records     Records.
+     */
+    void report(::std::string_view records);
+
+    /**
+     * @brief       Drop a worker, its unit is queued again if no other copy
+     *              runs.
+     *
+     * @param[in]   fd          Socket of worker.
+     */
+    void drop(int fd);
+};
+
+/**
+ * @brief       Worker searching units handed by a coordinator.
+ */
+class ClusterWorker {
+  private:
+    SearchOptions m_options; ///< Options, targets are sent by coordinator.
+    ::std::string m_secret;  ///< Shared secret.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   options     Options of traversal.
+     * @param[in]   secret      Secret sent to the coordinator.
+     */
+    ClusterWorker(SearchOptions options, ::std::string secret);
+
+    /**
+     * @brief       Connect to the coordinator and search units until it
+     *              closes the connection.
+     *
+     * @param[in]   host        Host of coordinator.
+     * @param[in]   port        Port or service name.
+     *
+     * @return      Number of units searched.
+     *
+     * @throw       ::std::system_error
+     */
+    ::std::size_t run(const ::std::string &host, const ::std::string &port);
+};
+
+} // namespace findlink
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace findlink {
+
+/**
+ * @brief       Sharded concurrent hash map.
+ *
+ * Keys are spread over independently locked shards, so concurrent readers
+ * never block each other and writers only contend within one shard.
+ *
+ * @tparam      Key         Key type.
+ * @tparam      Value       Value type.
+ * @tparam      Hash        Hash type.
+ * @tparam      SHARDS      Number of shards, power of 2.
+ */
+template<typename Key,
+         typename Value,
+         typename Hash        = ::std::hash<Key>,
+         ::std::size_t SHARDS = 64>
+class ConcurrentMap {
+    static_assert((SHARDS & (SHARDS - 1)) == 0,
+                  "Number of shards must be power of 2.");
+
+  private:
+    /**
+     * @brief       Shard.
+     */
+    struct alignas(64) Shard {
+        mutable ::std::shared_mutex             lock; ///< Lock.
+        ::std::unordered_map<Key, Value, Hash> map;  ///< Map.
+    };
+
+  private:
+    ::std::array<Shard, SHARDS> m_shards; ///< Shards.
+
+  public:
+    /**
+     * @brief       Find value.
+     *
+     * @param[in]   key         Key.
+     *
+     * @return      Copy of the value if found.
+     */
+    ::std::optional<Value> find(const Key &key) const
+    {
+        auto                                &shard = this->shard(key);
+        ::std::shared_lock<::std::shared_mutex> lock(shard.lock);
+        auto                                 iter = shard.map.find(key);
+        if (iter == shard.map.end()) {
+            return ::std::nullopt;
+        }
+
+        return iter->second;
+    }
+
+    /**
+     * @brief       Insert value if key does not exist.
+     *
+     * @param[in]   key         Key.
+     * @param[in]   value       Value.
+     *
+     * @return      \c true if inserted, \c false if the key exists.
+     */
+    bool insert(const Key &key, const Value &value)
+    {
+        auto                                &shard = this->shard(key);
+        ::std::unique_lock<::std::shared_mutex> lock(shard.lock);
+        return shard.map.emplace(key, value).second;
+    }
+
+    /**
+     * @brief       Get number of elements.
+     *
+     * @return      Number of elements.
+     */
+    ::std::size_t size() const
+    {
+        ::std::size_t ret = 0;
+        for (auto &shard : m_shards) {
+            ::std::shared_lock<::std::shared_mutex> lock(shard.lock);
+            ret += shard.map.size();
+        }
+
+        return ret;
+    }
+
+  private:
+    /**
+     * @brief       Get shard of key.
+     *
+     * @param[in]   key         Key.
+     *
+     * @return      Shard.
+     */
+    inline Shard &shard(const Key &key) const
+    {
+        // Mix high bits in, std::hash may be identity.
+        auto hash = Hash {}(key);
+        hash ^= hash >> 17;
+        return const_cast<Shard &>(m_shards[hash & (SHARDS - 1)]);
+    }
+};
+
+} // namespace findlink
@@ -0,0 +1,16 @@
+#pragma once
+
+namespace findlink {
+
+/**
+ * @brief       Get number of CPUs this process may use.
+ *
+ * Takes the smaller one of the CPU affinity mask and the cgroup CPU quota
+ * (cgroup v2 cpu.max or cgroup v1 cpu.cfs_quota_us), so containers with a
+ * quota lower than the host CPU count are detected.
+ *
+ * @return      Number of CPUs, at least 1.
+ */
+unsigned int availableCpuCount();
+
+} // namespace findlink
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace findlink {
+
+/**
+ * @brief       Filter of directories not to descend into.
+ *
+ * Directories are skipped by exact path, by glob on name or by glob on path.
+ * Exact paths come from excluded prefixes and mount points read from
+ * /proc/self/mountinfo. Their parents are kept too, so a directory without
+ * any of them as child is checked by a single lookup, and the paths of its
+ * children are never built.
+ */
+class DirFilter {
+  private:
+    /**
+     * @brief       Transparent string hash.
+     */
+    struct Hash {
+        using is_transparent = void;
+
+        inline ::std::size_t operator()(::std::string_view str) const
+        {
+            return ::std::hash<::std::string_view> {}(str);
+        }
+    };
+
+    using Set = ::std::unordered_set<::std::string, Hash, ::std::equal_to<>>;
+
+  private:
+    Set                          m_paths;     ///< Paths skipped.
+    Set                          m_parents;   ///< Parents of paths skipped.
+    ::std::vector<::std::string> m_nameGlobs; ///< Globs on name.
+    ::std::vector<::std::string> m_pathGlobs; ///< Globs on path.
+    ::std::vector<::std::string> m_fsTypes;   ///< Filesystem types skipped.
+
+  public:
+    /**
+     * @brief       Add exclude pattern.
+     *
+     * A pattern without glob characters is an absolute path prefix, a
+     * pattern with '/' is matched against the full path, others are matched
+     * against the directory name.
+     *
+     * @param[in]   pattern     Pattern.
+     */
+    void addExclude(const ::std::string &pattern);
+
+    /**
+     * @brief       Skip mount points of a filesystem type, must be called
+     *              before \c addMounts().
+     *
+     * @param[in]   type        Filesystem type.
+     */
+    void addFsType(const ::std::string &type);
+
+    /**
+     * @brief       Skip mount points of pseudo filesystems and of types
+     *              added, and of other filesystems if \c oneFileSystem is
+     *              set or \c devs is not empty.
+     *
+     * @param[in]   root            Search directory, never skipped.
+     * @param[in]   rootDev         Device of search directory.
+     * @param[in]   oneFileSystem   Skip mount points of other devices.
+     * @param[in]   devs            Devices kept besides \c rootDev, empty
+     *                              to keep all.
+     */
+    void addMounts(const ::std::string        &root,
+                   dev_t                       rootDev,
+                   bool                        oneFileSystem,
+                   const ::std::vector<dev_t> &devs = {});
+
+    /**
+     * @brief       Check if children of directory should be checked.
+     *
+     * @param[in]   dir         Directory.
+     *
+     * @return      \c true if should be checked.
+     */
+    inline bool checkChildren(::std::string_view dir) const
+    {
+        return ! m_nameGlobs.empty() || ! m_pathGlobs.empty()
+               || m_parents.find(dir) != m_parents.end();
+    }
+
+    /**
+     * @brief       Check if subdirectory is excluded.
+     *
+     * @param[in]   dir         Directory.
+     * @param[in]   name        Name of subdirectory.
+     *
+     * @return      \c true if excluded, \c false if not.
+     */
+    bool excluded(const ::std::string &dir, ::std::string_view name) const;
+
+  private:
+    /**
+     * @brief       Add path skipped.
+     *
+     * @param[in]   path        Absolute normalized path.
+     */
+    void addPath(::std::string path);
+};
+
+} // namespace findlink
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include <sys/types.h>
+
+namespace findlink {
+
+/**
+ * @brief       Directory scanner.
+ *
+ * Reads raw getdents64 records from an open directory fd. Entries are
+ * classified by d_type, and links are read relative to the directory fd, so
+ * no full path is looked up per entry.
+ *
+ * Entries are read in batches of one getdents64 call. The offset after a
+ * batch can be handed to another scanner of the same directory, which
+ * seeks to it and reads the batches following, so a large directory is
+ * scanned by several threads.
+ */
+class DirScanner {
+  public:
+    /**
+     * @brief       Directory entry.
+     */
+    struct Entry {
+        ::std::string_view name; ///< Entry name, NUL-terminated.
+        ino_t              ino;  ///< Inode number.
+        uint8_t            type; ///< d_type, DT_UNKNOWN resolved lazily.
+    };
+
+  private:
+    static constexpr ::std::size_t BUFFER_SIZE = 32 * 1024;
+
+  private:
+    const ::std::string &m_path;           ///< Directory path.
+    int                  m_fd;             ///< Directory fd.
+    ::std::size_t        m_offset;         ///< Offset in buffer.
+    ::std::size_t        m_size;           ///< Size of data in buffer.
+    alignas(8) char m_buffer[BUFFER_SIZE]; ///< getdents64 buffer.
+
+  public:
+    /**
+     * @brief       Constructor, open directory.
+     *
+     * @param[in]   path        Directory path, must outlive the scanner.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    explicit DirScanner(const ::std::string &path);
+
+    /**
+     * @brief       Constructor, take an opened directory fd.
+     *
+     * @param[in]   fd          Directory fd, closed by the scanner.
+     * @param[in]   path        Directory path, must outlive the scanner.
+     */
+    DirScanner(int fd, const ::std::string &path);
+
+    DirScanner(const DirScanner &)            = delete;
+    DirScanner &operator=(const DirScanner &) = delete;
+
+    /**
+     * @brief       Destructor, close directory.
+     */
+    ~DirScanner();
+
+    /**
+     * @brief       Get directory fd.
+     *
+     * @return      Directory fd.
+     */
+    inline int fd() const
+    {
+        return m_fd;
+    }
+
+    /**
+     * @brief       Get directory path.
+     *
+     * @return      Directory path.
+     */
+    inline const ::std::string &path() const
+    {
+        return m_path;
+    }
+
+    /**
+     * @brief       Read next entry, "." and ".." are skipped.
+     *
+     * @param[out]  entry       Entry read, valid until next call.
+     *
+     * @return      \c true if an entry is read, \c false at end of directory.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    bool next(Entry &entry);
+
+    /**
+     * @brief       Read next batch of entries.
+     *
+     * @return      \c true if a batch is read, \c false at end of directory.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    bool nextBatch();
+
+    /**
+     * @brief       Read next entry of current batch, "." and ".." are
+     *              skipped.
+     *
+     * @param[out]  entry       Entry read, valid until next call.
+     *
+     * @return      \c true if an entry is read, \c false at end of batch.
+     */
+    bool nextInBatch(Entry &entry);
+
+    /**
+     * @brief       Check if current batch fills most of the buffer, so more
+     *              batches likely follow.
+     *
+     * @return      \c true if full, \c false if not.
+     */
+    inline bool batchFull() const
+    {
+        return m_size > BUFFER_SIZE / 2;
+    }
+
+    /**
+     * @brief       Get offset of directory after current batch.
+     *
+     * @return      Offset to pass to \c seek().
+     */
+    off_t batchEnd() const;
+
+    /**
+     * @brief       Seek directory, current batch is dropped.
+     *
+     * @param[in]   offset      Offset got from \c batchEnd().
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    void seek(off_t offset);
+
+    /**
+     * @brief       Get entry type, stat the entry if the filesystem does not
+     *              report d_type.
+     *
+     * @param[in]   entry       Entry.
+     *
+     * @return      Entry type.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    uint8_t type(Entry &entry) const;
+
+    /**
+     * @brief       Read link target relative to the directory fd.
+     *
+     * @param[in]   entry       Link entry.
+     *
+     * @return      Raw link target.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    ::std::string readLink(const Entry &entry) const;
+
+  private:
+    /**
+     * @brief       Throw filesystem error of current errno.
+     *
+     * @param[in]   what        Description.
+     * @param[in]   name        Entry name, empty for the directory itself.
+     */
+    [[noreturn]] void throwError(const char        *what,
+                                 ::std::string_view name = {}) const;
+};
+
+} // namespace findlink
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <findlink/dir_filter.h>
+#include <findlink/link_map.h>
+#include <findlink/link_resolver.h>
+#include <findlink/searcher.h>
+
+namespace findlink {
+
+/**
+ * @brief       Daemon keeping a link map of a directory current.
+ *
+ * The directory is traversed once at start into a \c LinkMap, and an
+ * inotify watch on each directory reports links created, removed and
+ * renamed, which are applied to the map one by one. New directories are
+ * scanned by the daemon thread when they appear, with the resolver of the
+ * events read with them, and everything is traversed again when the event
+ * queue overflows.
+ *
+ * Queries are served over a Unix stream socket. A request is a mode byte,
+ * '=' for links to the target or '/' for links to or under it, followed by
+ * the target and a NUL. The response is "LINK\0RAW\0TARGET\0" for each
+ * link, ended by an extra NUL.
+ *
+ * Links are resolved when they are seen, a link whose target is changed or
+ * created later keeps its old state until it is seen again. A link failing
+ * to resolve, such as a dangling one, is reported and not kept, so it is
+ * not found when its target is created later until it is recreated or the
+ * daemon restarts.
+ */
+class LinkDaemon {
+  public:
+    class Client;
+
+  private:
+    /// Buffer size of inotify events.
+    static constexpr ::std::size_t EVENT_BUFFER_SIZE = 64 * 1024;
+
+    /// Size limit of a request.
+    static constexpr ::std::size_t MAX_REQUEST_SIZE = 64 * 1024;
+
+  private:
+    ::std::filesystem::path m_root;      ///< Directory watched.
+    Searcher                m_searcher;  ///< Searcher.
+    Searcher::ErrorFunc     m_onError;   ///< Error callback.
+    DirFilter               m_filter;    ///< Directories skipped.
+    dev_t                   m_rootDev;   ///< Device of directory watched.
+    int                     m_inotifyFd; ///< inotify fd.
+    LinkMap                 m_links;     ///< Links.
+    ::std::mutex            m_lock;      ///< Lock while traversing.
+
+    /// Directories watched by watch descriptor.
+    ::std::unordered_map<int, ::std::string> m_watches;
+
+    /// Watch descriptors by directory.
+    ::std::map<::std::string, int, ::std::less<>> m_dirs;
+
+  public:
+    /**
+     * @brief       Constructor, traverse the directory.
+     *
+     * @param[in]   root        Canonical directory to watch.
+     * @param[in]   options     Search options.
+     * @param[in]   onError     Error callback.
+     *
+     * @throw       ::std::system_error
+     */
+    LinkDaemon(const ::std::filesystem::path &root,
+               const SearchOptions           &options,
+               const Searcher::ErrorFunc     &onError);
+
+    LinkDaemon(const LinkDaemon &)            = delete;
+    LinkDaemon &operator=(const LinkDaemon &) = delete;
+
+    /**
+     * @brief       Destructor.
+     */
+    ~LinkDaemon();
+
+    /**
+     * @brief       Get links.
+     *
+     * @return      Links.
+     */
+    inline const LinkMap &links() const
+    {
+        return m_links;
+    }
+
+    /**
+     * @brief       Serve queries until SIGINT or SIGTERM.
+     *
+     * @param[in]   socketPath  Path of socket, removed at end.
+     *
+     * @throw       ::std::system_error
+     */
+    void serve(const ::std::filesystem::path &socketPath);
+
+  private:
+    /**
+     * @brief       Drop everything and traverse the directory again.
+     *
+     * @throw       ::std::system_error
+     */
+    void reload();
+
+    /**
+     * @brief       Traverse directory, add its links and watches.
+     *
+     * @param[in]   dir         Canonical directory.
+     */
+    void scan(const ::std::string &dir);
+
+    /**
+     * @brief       Scan a new directory and all under it in this thread, add
+     *              their links and watches.
+     *
+     * @param[in]   resolver    Resolver.
+     * @param[in]   dir         Canonical directory.
+     */
+    void scanNew(LinkResolver &resolver, const ::std::string &dir);
+
+    /**
+     * @brief       Watch directory.
+     *
+     * @param[in]   dir         Canonical directory.
+     *
+     * @return      \c true on success, \c false if reported as error.
+     */
+    bool watch(const ::std::string &dir);
+
+    /**
+     * @brief       Read link and add it, an old link of the path is removed if
+     *              not a link or not resolved.
+     *
+     * @param[in]   resolver    Resolver.
+     * @param[in]   dir         Canonical directory which contains the link.
+     * @param[in]   name        Name of link.
+     */
+    void addLink(LinkResolver        &resolver,
+                 const ::std::string &dir,
+                 ::std::string_view   name);
+
+    /**
+     * @brief       Remove links and watches of a directory and all under it.
+     *
+     * @param[in]   dir         Directory.
+     */
+    void removeDir(const ::std::string &dir);
+
+    /**
+     * @brief       Read and apply inotify events.
+     *
+     * @throw       ::std::system_error
+     */
+    void handleEvents();
+
+    /**
+     * @brief       Answer complete requests in buffer.
+     *
+     * @param[in]       fd          Client fd.
+     * @param[in, out]  buffer      Data received, requests answered are
+     *                              removed.
+     *
+     * @return      \c true on success, \c false if the client is gone.
+     */
+    bool handleRequests(int fd, ::std::string &buffer);
+};
+
+/**
+ * @brief       Client of link daemon.
+ */
+class LinkDaemon::Client {
+  private:
+    int           m_fd;     ///< Socket.
+    ::std::string m_buffer; ///< Data received.
+
+  public:
+    /**
+     * @brief       Constructor, connect to the daemon.
+     *
+     * @param[in]   socketPath  Path of socket.
+     *
+     * @throw       ::std::system_error
+     */
+    explicit Client(const ::std::filesystem::path &socketPath);
+
+    Client(const Client &)            = delete;
+    Client &operator=(const Client &) = delete;
+
+    /**
+     * @brief       Destructor.
+     */
+    ~Client();
+
+    /**
+     * @brief       Query links pointing to target.
+     *
+     * @param[in]   target      Canonical target.
+     * @param[in]   under       Also match links pointing under target.
+     * @param[in]   func        Callback.
+     *
+     * @throw       ::std::system_error
+     */
+    void query(::std::string_view        target,
+               bool                      under,
+               const LinkMap::QueryFunc &func);
+};
+
+} // namespace findlink
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace findlink {
+
+/**
+ * @brief       On-disk symbol link index.
+ *
+ * The file is a header, an array of fixed size link records sorted by
+ * (target, link), an array of directory records sorted by path, and a string
+ * blob the records point into. It is queried by binary search over the
+ * mapped file without parsing it. Directory records keep the metadata needed
+ * to refresh the index without scanning unchanged directories.
+ *
+ * Links that cannot be resolved are kept too, with an empty target, so they
+ * sort before the others. Queries skip them, and a refresh resolves them
+ * again even in unchanged directories. Directories that cannot be scanned
+ * are kept with device and inode 0, which never match, so a refresh scans
+ * them again even when their parent is unchanged.
+ */
+class LinkIndex {
+  public:
+    /// Magic of index file.
+    static constexpr char MAGIC[8] = {'F', 'L', 'N', 'K', 'I', 'D', 'X', '\0'};
+
+    /// Version of index file.
+    static constexpr uint32_t VERSION = 3;
+
+    /**
+     * @brief       File header.
+     */
+    struct Header {
+        char     magic[8];      ///< Magic.
+        uint32_t version;       ///< Version.
+        uint32_t rootSize;      ///< Size of search directory.
+        uint64_t rootOffset;    ///< Offset of search directory in strings.
+        uint64_t recordCount;   ///< Number of link records.
+        uint64_t recordsOffset; ///< Offset of link records.
+        uint64_t dirCount;      ///< Number of directory records.
+        uint64_t dirsOffset;    ///< Offset of directory records.
+        uint64_t stringsOffset; ///< Offset of strings.
+        uint64_t stringsSize;   ///< Size of strings.
+
+        /// Number of link records of unresolved links, first of records.
+        uint64_t unresolvedCount;
+    };
+
+    /**
+     * @brief       Link record.
+     */
+    struct Record {
+        uint64_t targetOffset; ///< Offset of target in strings.
+        uint64_t linkOffset;   ///< Offset of link in strings.
+        uint64_t rawOffset;    ///< Offset of raw link target in strings.
+        uint32_t targetSize;   ///< Size of target.
+        uint32_t linkSize;     ///< Size of link.
+        uint32_t rawSize;      ///< Size of raw link target.
+        uint32_t reserved;     ///< Reserved.
+    };
+
+    /**
+     * @brief       Directory record.
+     */
+    struct DirRecord {
+        uint64_t pathOffset; ///< Offset of path in strings.
+        uint32_t pathSize;   ///< Size of path.
+        uint32_t reserved;   ///< Reserved.
+        uint64_t dev;        ///< Device.
+        uint64_t ino;        ///< Inode.
+        int64_t  mtime;      ///< Modification time in nanoseconds.
+        int64_t  ctime;      ///< Status change time in nanoseconds.
+
+        /**
+         * @brief       Check if the directory is unchanged.
+         *
+         * @param[in]   st          Current stat of the directory.
+         *
+         * @return      \c true if unchanged, \c false if changed.
+         */
+        bool unchanged(const struct stat &st) const;
+    };
+
+    /// Query result callback, called with (link, raw link target, target).
+    using QueryFunc = ::std::function<void(
+        ::std::string_view, ::std::string_view, ::std::string_view)>;
+
+    /// Link callback, called with (link, raw link target, target).
+    using LinkFunc = ::std::function<void(
+        ::std::string_view, ::std::string_view, ::std::string_view)>;
+
+    /// Directory callback, called with (path, record).
+    using DirFunc
+        = ::std::function<void(::std::string_view, const DirRecord &)>;
+
+    /**
+     * @brief       Index builder.
+     */
+    class Builder {
+      private:
+        ::std::mutex m_lock; ///< Lock.
+
+        /// Links, (target, link, raw link target).
+        ::std::vector<::std::tuple<::std::string, ::std::string, ::std::string>>
+            m_links;
+
+        /// Directories, (path, record without path).
+        ::std::vector<::std::pair<::std::string, DirRecord>> m_dirs;
+
+      public:
+        /**
+         * @brief       Add link, thread safe.
+         *
+         * @param[in]   link        Link path.
+         * @param[in]   raw         Raw link target.
+         * @param[in]   target      Canonical path the link points to, empty
+         *                          if unresolved.
+         */
+        void add(::std::string link, ::std::string raw, ::std::string target);
+
+        /**
+         * @brief       Add directory scanned, thread safe.
+         *
+         * @param[in]   path        Directory path.
+         * @param[in]   st          Stat of the directory.
+         */
+        void addDir(::std::string path, const struct stat &st);
+
+        /**
+         * @brief       Add directory failed to scan, thread safe. It
+         *              replaces a record of the same path added by
+         *              \c addDir().
+         *
+         * @param[in]   path        Directory path.
+         */
+        void addFailedDir(::std::string path);
+
+        /**
+         * @brief       Write index file, the file is replaced atomically.
+         *
+         * @param[in]   path        Path of index file.
+         * @param[in]   root        Search directory.
+         *
+         * @throw       ::std::system_error
+         */
+        void write(const ::std::filesystem::path &path,
+                   const ::std::filesystem::path &root);
+    };
+
+  private:
+    const char      *m_data;        ///< Mapped file.
+    ::std::size_t    m_size;        ///< Size of file.
+    const Record    *m_records;     ///< Link records.
+    ::std::size_t    m_count;       ///< Number of link records.
+    ::std::size_t    m_unresolved;  ///< Number of unresolved link records.
+    const DirRecord *m_dirs;        ///< Directory records.
+    ::std::size_t    m_dirCount;    ///< Number of directory records.
+    const char      *m_strings;     ///< Strings.
+    ::std::size_t    m_stringsSize; ///< Size of strings.
+    uint64_t         m_rootOffset;  ///< Offset of search directory.
+    uint32_t         m_rootSize;    ///< Size of search directory.
+
+  public:
+    /**
+     * @brief       Constructor, map index file.
+     *
+     * @param[in]   path        Path of index file.
+     *
+     * @throw       ::std::system_error, ::std::runtime_error
+     */
+    explicit LinkIndex(const ::std::filesystem::path &path);
+
+    LinkIndex(const LinkIndex &)            = delete;
+    LinkIndex &operator=(const LinkIndex &) = delete;
+
+    /**
+     * @brief       Destructor, unmap index file.
+     */
+    ~LinkIndex();
+
+    /**
+     * @brief       Get number of links resolved.
+     *
+     * @return      Number of links.
+     */
+    inline ::std::size_t size() const
+    {
+        return m_count - m_unresolved;
+    }
+
+    /**
+     * @brief       Get search directory the index is built from.
+     *
+     * @return      Search directory.
+     *
+     * @throw       ::std::runtime_error
+     */
+    inline ::std::string_view root() const
+    {
+        return this->string(m_rootOffset, m_rootSize);
+    }
+
+    /**
+     * @brief       Query links pointing to target.
+     *
+     * @param[in]   target      Canonical target.
+     * @param[in]   under       Also match links pointing under target.
+     * @param[in]   func        Result callback.
+     *
+     * @return      Number of links found.
+     *
+     * @throw       ::std::runtime_error
+     */
+    ::std::size_t query(::std::string_view target,
+                        bool               under,
+                        const QueryFunc   &func) const;
+
+    /**
+     * @brief       Iterate all links, unresolved ones first with an empty
+     *              target.
+     *
+     * @param[in]   func        Link callback.
+     *
+     * @throw       ::std::runtime_error
+     */
+    void forEachLink(const LinkFunc &func) const;
+
+    /**
+     * @brief       Iterate all directories.
+     *
+     * @param[in]   func        Directory callback.
+     *
+     * @throw       ::std::runtime_error
+     */
+    void forEachDir(const DirFunc &func) const;
+
+  private:
+    /**
+     * @brief       Get string in string blob.
+     *
+     * @param[in]   offset      Offset.
+     * @param[in]   size        Size.
+     *
+     * @return      String.
+     *
+     * @throw       ::std::runtime_error
+     */
+    ::std::string_view string(uint64_t offset, uint32_t size) const;
+
+    /**
+     * @brief       Get target of record.
+     *
+     * @param[in]   record      Record.
+     *
+     * @return      Target.
+     */
+    inline ::std::string_view target(const Record &record) const
+    {
+        return this->string(record.targetOffset, record.targetSize);
+    }
+
+    /**
+     * @brief       Get link of record.
+     *
+     * @param[in]   record      Record.
+     *
+     * @return      Link.
+     */
+    inline ::std::string_view link(const Record &record) const
+    {
+        return this->string(record.linkOffset, record.linkSize);
+    }
+
+    /**
+     * @brief       Find first resolved record whose target is not less than
+     *              key.
+     *
+     * @param[in]   key         Key.
+     *
+     * @return      Index of record.
+     */
+    ::std::size_t lowerBound(::std::string_view key) const;
+
+    /**
+     * @brief       Report records in range.
+     *
+     * @param[in]   begin       First record.
+     * @param[in]   end         End of records.
+     * @param[in]   func        Result callback.
+     */
+    void report(::std::size_t    begin,
+                ::std::size_t    end,
+                const QueryFunc &func) const;
+};
+
+} // namespace findlink
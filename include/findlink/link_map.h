@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace findlink {
+
+/**
+ * @brief       In-memory symbol link map.
+ *
+ * Links are kept sorted by path, so links under a directory are removed as
+ * a range, and indexed by target, so links to a target or under it
+ * are queried as ranges like \c LinkIndex. Not thread safe.
+ */
+class LinkMap {
+  public:
+    /// Query callback, called with (link, raw link target, target).
+    using QueryFunc = ::std::function<void(
+        ::std::string_view, ::std::string_view, ::std::string_view)>;
+
+  private:
+    /**
+     * @brief       Link.
+     */
+    struct Link {
+        ::std::string raw;    ///< Raw link target.
+        ::std::string target; ///< Canonical path the link points to.
+    };
+
+    /// Links by path.
+    using Links = ::std::map<::std::string, Link, ::std::less<>>;
+
+    /// Index of links, (target, link, raw), viewing strings of \c Links.
+    using TargetIndex = ::std::set<::std::tuple<::std::string_view,
+                                                ::std::string_view,
+                                                ::std::string_view>>;
+
+  private:
+    Links       m_links;   ///< Links by path.
+    TargetIndex m_targets; ///< Links by target.
+
+  public:
+    /**
+     * @brief       Get number of links.
+     *
+     * @return      Number of links.
+     */
+    inline ::std::size_t size() const
+    {
+        return m_links.size();
+    }
+
+    /**
+     * @brief       Add link, an old link of the same path is replaced.
+     *
+     * @param[in]   link        Link path.
+     * @param[in]   raw         Raw link target.
+     * @param[in]   target      Canonical path the link points to.
+     */
+    void add(::std::string link, ::std::string raw, ::std::string target);
+
+    /**
+     * @brief       Remove link.
+     *
+     * @param[in]   link        Link path.
+     */
+    void remove(::std::string_view link);
+
+    /**
+     * @brief       Remove all links under a directory.
+     *
+     * @param[in]   dir         Directory.
+     */
+    void removeUnder(::std::string_view dir);
+
+    /**
+     * @brief       Remove all links.
+     */
+    void clear();
+
+    /**
+     * @brief       Query links pointing to target.
+     *
+     * @param[in]   target      Canonical target.
+     * @param[in]   under       Also match links pointing under target.
+     * @param[in]   func        Callback.
+     *
+     * @return      Number of links found.
+     */
+    ::std::size_t query(::std::string_view target,
+                        bool               under,
+                        const QueryFunc   &func) const;
+
+  private:
+    /**
+     * @brief       Remove links in range.
+     *
+     * @param[in]   begin       Begin of range.
+     * @param[in]   end         End of range.
+     */
+    void erase(Links::iterator begin, Links::iterator end);
+
+    /**
+     * @brief       Report links in range of index.
+     *
+     * @param[in]   begin       Begin of range.
+     * @param[in]   end         End of range.
+     * @param[in]   func        Callback.
+     *
+     * @return      Number of links reported.
+     */
+    ::std::size_t report(TargetIndex::const_iterator begin,
+                         TargetIndex::const_iterator end,
+                         const QueryFunc            &func) const;
+};
+
+} // namespace findlink
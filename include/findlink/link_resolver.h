@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <findlink/concurrent_map.h>
+#include <findlink/stats.h>
+#include <findlink/target_set.h>
+
+namespace findlink {
+
+/**
+ * @brief       Symbol link resolver.
+ *
+ * Resolves link targets lexically against canonical paths. A path component
+ * only costs a syscall when it is neither on the canonical chain of a
+ * target nor on the chain of the directory containing the link, and the
+ * result of each such directory prefix is memoized in a shared cache.
+ *
+ * Links met while resolving, like b and c of a chain a -> b -> c, are
+ * memoized in the same cache with their final target or error, so every
+ * link of a chain is read once per resolver however many links pass
+ * through it.
+ *
+ * Sibling links may be resolved as a batch: their parents are resolved
+ * through the cache, and the last components sharing a canonical parent
+ * are checked relative to a single fd of it instead of by full paths.
+ */
+class LinkResolver {
+  public:
+    /**
+     * @brief       Link of a batch.
+     */
+    struct BatchLink {
+        ::std::string_view name;     ///< Name of link.
+        ::std::string      raw;      ///< Raw link target.
+        uint64_t           ino;      ///< Inode of link.
+        ::std::string      linkedTo; ///< Canonical path the link points to.
+
+        /// Error resolving the link, if any.
+        ::std::optional<::std::filesystem::filesystem_error> error;
+    };
+
+  private:
+    static constexpr int MAX_LINK_DEPTH = 40; ///< Same as SYMLOOP_MAX.
+
+    /**
+     * @brief       Cached resolution.
+     */
+    struct Resolution {
+        ::std::string path;  ///< Canonical path, or path failed on error.
+        int           error; ///< Error number, 0 on success.
+        bool          link;  ///< \c true if a link, \c false if a directory.
+    };
+
+  private:
+    const TargetSet &m_targets; ///< Canonical targets.
+    Stats           *m_stats;   ///< Stats, may be \c nullptr.
+
+    /// Resolved directory prefixes and links, keyed by path.
+    ConcurrentMap<::std::string, Resolution> m_cache;
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   targets     Canonical targets, must outlive the
+     *                          resolver.
+     * @param[in]   stats       Stats to count syscalls and cache hits in,
+     *                          may be \c nullptr.
+     */
+    explicit LinkResolver(const TargetSet &targets, Stats *stats = nullptr);
+
+    /**
+     * @brief       Resolve link.
+     *
+     * @param[in]   dir         Canonical directory which contains the link.
+     * @param[in]   link        Raw link target.
+     *
+     * @return      Canonical path the link points to.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    ::std::string resolve(::std::string_view dir, ::std::string_view link);
+
+    /**
+     * @brief       Resolve link found in a directory, a link already
+     *              resolved as part of another chain is not resolved again.
+     *
+     * @param[in]   dir         Canonical directory which contains the link.
+     * @param[in]   name        Name of link.
+     * @param[in]   link        Raw link target.
+     *
+     * @return      Canonical path the link points to.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    ::std::string resolve(::std::string_view dir,
+                          ::std::string_view name,
+                          ::std::string_view link);
+
+    /**
+     * @brief       Resolve sibling links found in a directory.
+     *
+     * @param[in]       dir     Canonical directory which contains the
+     *                          links.
+     * @param[in]       dirFd   Fd of \c dir, -1 if none.
+     * @param[in, out]  links   Links, \c linkedTo or \c error is set.
+     */
+    void resolveBatch(::std::string_view        dir,
+                      int                       dirFd,
+                      ::std::vector<BatchLink> &links);
+
+  private:
+    /**
+     * @brief       Resolve path relative to a canonical directory.
+     *
+     * @param[in]   dir         Canonical directory.
+     * @param[in]   path        Path to resolve.
+     * @param[in]   depth       Number of links followed.
+     *
+     * @return      Canonical path.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    ::std::string resolveAt(::std::string_view dir,
+                            ::std::string_view path,
+                            int               &depth);
+
+    /**
+     * @brief       Take a resolution from the cache.
+     *
+     * @param[in]       path        Path.
+     * @param[in, out]  resolved    Set to the canonical path if cached.
+     *
+     * @return      \c true if cached, \c false if not.
+     *
+     * @throw       ::std::filesystem::filesystem_error  The cached error.
+     */
+    bool fromCache(const ::std::string &path, ::std::string &resolved);
+
+    /**
+     * @brief       Check if a path is known to be canonical and existing
+     *              without syscalls.
+     *
+     * @param[in]   path        Path to check.
+     * @param[in]   dir         Canonical directory.
+     * @param[in]   last        \c true if \c path is the last component,
+     *                          \c false if it must be a directory.
+     *
+     * @return      \c true if known, \c false if unknown.
+     */
+    bool isKnown(::std::string_view path,
+                 ::std::string_view dir,
+                 bool               last) const;
+};
+
+} // namespace findlink
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <findlink/thread_slot.h>
+
+namespace findlink {
+
+/**
+ * @brief       Buffered output of records.
+ *
+ * Each thread appends records to a buffer of its own, under a lock of the
+ * buffer only contended by the flush thread. A buffer is written to the fd
+ * with write(2) when it is full, when the sink is flushed, or by the flush
+ * thread every \c FLUSH_INTERVAL, so a record found by a thread which finds
+ * nothing more is not held until the end. Output to a terminal is written
+ * per record, without a flush thread. A chunk always ends at a record
+ * boundary and chunks are written under a lock, so records of different
+ * threads never interleave.
+ */
+class OutputSink {
+  public:
+    /// Size a buffer is written at.
+    static constexpr ::std::size_t BUFFER_SIZE = 64 * 1024;
+
+    /// Interval the flush thread writes buffers at.
+    static constexpr ::std::chrono::milliseconds FLUSH_INTERVAL {1000};
+
+  private:
+    /**
+     * @brief       Buffer of a thread.
+     */
+    struct alignas(64) Buffer {
+        ::std::mutex  lock; ///< Lock of data.
+        ::std::string data; ///< Data.
+    };
+
+  private:
+    int                       m_fd;         ///< Output fd.
+    char                      m_terminator; ///< Record terminator.
+    bool                      m_perRecord;  ///< Write each record.
+    ::std::mutex              m_lock;       ///< Lock of fd.
+    ::std::atomic<int>        m_error;      ///< errno of failed write.
+    ThreadSlots<Buffer>       m_buffers;    ///< Buffers of threads.
+    bool                      m_stop;       ///< Stop flush thread.
+    ::std::mutex              m_stopLock;   ///< Lock of stop flag.
+    ::std::condition_variable m_cond;       ///< Stop condition.
+    ::std::thread             m_thread;     ///< Flush thread.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   fd          Output fd, not closed by the sink.
+     * @param[in]   terminator  Record terminator.
+     */
+    OutputSink(int fd, char terminator);
+
+    OutputSink(const OutputSink &)            = delete;
+    OutputSink &operator=(const OutputSink &) = delete;
+
+    /**
+     * @brief       Destructor, stop flush thread and flush all buffers.
+     */
+    ~OutputSink();
+
+    /**
+     * @brief       Write record, thread safe.
+     *
+     * @param[in]   record      Record.
+     */
+    void write(::std::string_view record);
+
+    /**
+     * @brief       Write record of two fields separated by tab, thread safe.
+     *
+     * @param[in]   first       First field.
+     * @param[in]   second      Second field.
+     */
+    void write(::std::string_view first, ::std::string_view second);
+
+    /**
+     * @brief       Write a whole encoded record without terminator, thread
+     *              safe.
+     *
+     * @param[in]   data        Record.
+     */
+    void writeRaw(::std::string_view data);
+
+    /**
+     * @brief       Flush buffers of all threads, thread safe.
+     */
+    void flush();
+
+    /**
+     * @brief       Check if writing failed.
+     *
+     * @return      \c true if failed, \c false if not.
+     */
+    inline bool failed() const
+    {
+        return this->error() != 0;
+    }
+
+    /**
+     * @brief       Get error of failed write.
+     *
+     * @return      errno of failed write, 0 if none.
+     */
+    inline int error() const
+    {
+        return m_error.load(::std::memory_order_relaxed);
+    }
+
+  private:
+    /**
+     * @brief       Get buffer of current thread.
+     *
+     * @return      Buffer.
+     */
+    Buffer &local();
+
+    /**
+     * @brief       Write buffer to fd if it is full or output is per record,
+     *              the buffer must be locked.
+     *
+     * @param[in]   buffer      Buffer.
+     */
+    inline void commit(Buffer &buffer)
+    {
+        if (m_perRecord || buffer.data.size() >= BUFFER_SIZE) {
+            this->writeOut(buffer);
+        }
+    }
+
+    /**
+     * @brief       Write buffer to fd and clear it, the buffer must be
+     *              locked.
+     *
+     * @param[in]   buffer      Buffer.
+     */
+    void writeOut(Buffer &buffer);
+};
+
+} // namespace findlink
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace findlink {
+
+/**
+ * @brief       Pool of directory path nodes.
+ *
+ * A directory is stored as its name and a pointer to the node of its parent,
+ * so a pending directory costs a small node instead of a full path, and the
+ * full path is only built when the directory is scanned. Nodes are reference
+ * counted by their own task and their children, a node is freed with its
+ * last child.
+ *
+ * Nodes are carved out of large blocks by per-thread allocators, freed nodes
+ * go back to the free list of the thread freeing them by size class. No lock
+ * is taken except to get a new block.
+ */
+class PathPool {
+  public:
+    /**
+     * @brief       Path node, the name follows the node in memory.
+     */
+    struct Node {
+        Node                   *parent;    ///< Parent, \c nullptr for root.
+        ::std::atomic<uint32_t> refs;      ///< Reference count.
+        uint32_t                nameSize;  ///< Size of name.
+        uint32_t                sizeClass; ///< Size class of allocation.
+
+        /**
+         * @brief       Get name.
+         *
+         * @return      Name, the root node holds the full search directory.
+         */
+        inline ::std::string_view name() const
+        {
+            return ::std::string_view(reinterpret_cast<const char *>(this + 1),
+                                      nameSize);
+        }
+
+        /**
+         * @brief       Build full path.
+         *
+         * @param[out]  path        Path built, replaced.
+         */
+        void path(::std::string &path) const;
+    };
+
+    /**
+     * @brief       Allocator of a thread.
+     */
+    class Local {
+      private:
+        /// Allocation granularity.
+        static constexpr ::std::size_t GRANULARITY = 16;
+
+        /// Number of size classes, larger nodes get a block of their own.
+        static constexpr ::std::size_t SIZE_CLASSES = 32;
+
+      private:
+        PathPool *m_pool; ///< Pool.
+        char     *m_next; ///< Next free byte of current block.
+        char     *m_end;  ///< End of current block.
+
+        /// Free lists of size classes.
+        ::std::array<Node *, SIZE_CLASSES> m_free;
+
+      public:
+        /**
+         * @brief       Constructor.
+         *
+         * @param[in]   pool        Pool.
+         */
+        explicit Local(PathPool &pool);
+
+        /**
+         * @brief       Create node, the node holds a reference of its parent.
+         *
+         * @param[in]   parent      Parent, \c nullptr for root.
+         * @param[in]   name        Name.
+         *
+         * @return      Node with a reference count of 1.
+         */
+        Node *create(Node *parent, ::std::string_view name);
+
+        /**
+         * @brief       Add a reference of node, for another task of the
+         *              same directory.
+         *
+         * @param[in]   node        Node.
+         */
+        inline void retain(Node *node)
+        {
+            node->refs.fetch_add(1, ::std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief       Release a reference of node, free the node and its
+         *              ancestors not referenced anymore.
+         *
+         * @param[in]   node        Node.
+         */
+        void release(Node *node);
+
+      private:
+        /**
+         * @brief       Allocate memory.
+         *
+         * @param[in]   sizeClass   Size class.
+         *
+         * @return      Memory.
+         */
+        void *allocate(::std::size_t sizeClass);
+    };
+
+  private:
+    /// Size of block.
+    static constexpr ::std::size_t BLOCK_SIZE = 256 * 1024;
+
+  private:
+    ::std::mutex                             m_lock;   ///< Lock.
+    ::std::vector<::std::unique_ptr<char[]>> m_blocks; ///< Blocks.
+
+  private:
+    /**
+     * @brief       Allocate block, thread safe.
+     *
+     * @param[in]   size        Size of block.
+     *
+     * @return      Block.
+     */
+    char *allocateBlock(::std::size_t size);
+};
+
+} // namespace findlink
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include <findlink/output_sink.h>
+
+namespace findlink {
+
+/**
+ * @brief       Append JSON string, '"', '\\' and control characters are
+ *              escaped, other bytes are kept as they are.
+ *
+ * @param[out]  out         Output.
+ * @param[in]   str         String.
+ */
+void appendJsonString(::std::string &out, ::std::string_view str);
+
+/**
+ * @brief       Writer of found links and errors in an output format.
+ *
+ * Text format prints the link, or "LINK<TAB>TARGET" when tagged, and errors
+ * to stderr. JSON Lines format writes one object per line:
+ *
+ *     {"type":"link","link":..,"raw":..,"target":..,"matched":..,
+ *      "dev":N,"ino":N}
+ *     {"type":"error","path":..,"errno":N,"kind":"ENOENT","message":..}
+ *
+ * Strings are written as raw bytes with '"', '\' and control characters
+ * escaped, paths not in UTF-8 are kept as they are.
+ *
+ * Binary format writes length-prefixed records in host byte order, a
+ * record begins with a type byte and the uint32_t size of the rest:
+ *
+ *     'L' size  str link  str raw  str target  str matched
+ *               uint64_t dev  uint64_t ino
+ *     'E' size  str path  int32_t errno  str message
+ *
+ * where "str" is a uint32_t size followed by the bytes. Records are appended
+ * to the output sink whole, records of different threads never interleave.
+ */
+class RecordWriter {
+  public:
+    /**
+     * @brief       Output format.
+     */
+    enum class Format {
+        TEXT,   ///< Text.
+        JSONL,  ///< JSON Lines.
+        BINARY, ///< Length-prefixed binary records.
+    };
+
+    /**
+     * @brief       Link found.
+     */
+    struct Link {
+        ::std::string_view path;    ///< Link path.
+        ::std::string_view raw;     ///< Raw link target.
+        ::std::string_view target;  ///< Canonical path the link points to.
+        ::std::string_view matched; ///< Target matched.
+        uint64_t           dev;     ///< Device, 0 if unknown.
+        uint64_t           ino;     ///< Inode, 0 if unknown.
+    };
+
+  private:
+    OutputSink &m_output; ///< Output.
+    Format      m_format; ///< Format.
+    bool        m_tagged; ///< Print matched target in text format.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   output      Output.
+     * @param[in]   format      Format.
+     * @param[in]   tagged      Print matched target in text format.
+     */
+    RecordWriter(OutputSink &output, Format format, bool tagged);
+
+    /**
+     * @brief       Write link found, thread safe.
+     *
+     * @param[in]   link        Link.
+     */
+    void writeLink(const Link &link);
+
+    /**
+     * @brief       Write error, thread safe.
+     *
+     * @param[in]   e           Error.
+     */
+    void writeError(const ::std::filesystem::filesystem_error &e);
+
+    /**
+     * @brief       Write error by its fields, thread safe.
+     *
+     * @param[in]   path        Path.
+     * @param[in]   err         Error number.
+     * @param[in]   message     Message.
+     */
+    void writeError(::std::string_view path,
+                    int                err,
+                    ::std::string_view message);
+};
+
+} // namespace findlink
@@ -0,0 +1,460 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+#include <findlink/stats.h>
+
+namespace findlink {
+
+/**
+ * @brief       Work-stealing scheduler.
+ *
+ * Each worker owns a deque. Workers push and pop their own deque LIFO, idle
+ * workers steal FIFO from the others. The run ends when no task is pending,
+ * which is tracked by a single counter instead of a shared queue lock.
+ * Cancelling drops every task queued, so the run ends as soon as the tasks
+ * running return.
+ *
+ * The pool can grow while running: when work is queued but the process uses
+ * much less CPU time than its workers could, they are blocked on I/O and
+ * another worker is started, up to a maximum.
+ *
+ * @tparam      Task        Task type, must be movable.
+ */
+template<typename Task>
+class Scheduler {
+  private:
+    /**
+     * @brief       Deque of a worker.
+     */
+    struct alignas(64) Deque {
+        ::std::mutex       lock;  ///< Lock.
+        ::std::deque<Task> tasks; ///< Tasks.
+    };
+
+  public:
+    /**
+     * @brief       Worker handle, passed to task function.
+     */
+    class Worker {
+        friend class Scheduler;
+
+      private:
+        Scheduler    &m_scheduler; ///< Scheduler.
+        ::std::size_t m_id;        ///< Worker ID.
+
+      private:
+        /**
+         * @brief       Constructor.
+         *
+         * @param[in]   scheduler   Scheduler.
+         * @param[in]   id          Worker ID.
+         */
+        Worker(Scheduler &scheduler, ::std::size_t id) :
+            m_scheduler(scheduler), m_id(id)
+        {}
+
+      public:
+        /**
+         * @brief       Get worker ID.
+         *
+         * @return      Worker ID, in range [0, threadCount).
+         */
+        inline ::std::size_t id() const
+        {
+            return m_id;
+        }
+
+        /**
+         * @brief       Push task to the deque of the worker.
+         *
+         * @param[in]   task        Task.
+         */
+        inline void push(Task &&task)
+        {
+            m_scheduler.push(m_id, ::std::move(task));
+        }
+    };
+
+  private:
+    static constexpr int STEAL_ROUNDS = 4; ///< Steal rounds before sleep.
+
+    /// Interval to check if the pool should grow.
+    static constexpr ::std::chrono::milliseconds GROW_INTERVAL {50};
+
+    /// CPU utilization below which workers are considered blocked on I/O.
+    static constexpr double GROW_UTILIZATION = 0.5;
+
+  private:
+    ::std::vector<::std::unique_ptr<Deque>> m_deques;   ///< Deques.
+    ::std::size_t                           m_initial;  ///< Initial workers.
+    unsigned int                            m_cpuCount; ///< CPU count.
+    ::std::atomic<::std::size_t>            m_active;   ///< Started workers.
+    ::std::atomic<::std::size_t>            m_pending;  ///< Unfinished tasks.
+    ::std::atomic<::std::size_t>            m_queued;   ///< Tasks in deques.
+    ::std::atomic<::std::size_t>            m_sleepers; ///< Sleeping workers.
+    ::std::atomic<bool>                     m_cancelled; ///< Cancelled.
+    ::std::mutex                            m_sleepLock; ///< Sleep lock.
+    ::std::condition_variable               m_sleepCond; ///< Sleep condition.
+    ::std::condition_variable               m_doneCond;  ///< Done condition.
+    Stats                                  *m_stats;     ///< Stats.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   threadCount     Number of workers to start with.
+     * @param[in]   maxThreadCount  Maximum number of workers, the pool does
+     *                              not grow if not greater than
+     *                              \c threadCount.
+     * @param[in]   cpuCount        Number of CPUs available, used to tell
+     *                              blocked workers from throttled ones.
+     * @param[in]   stats           Stats to count queue high water mark,
+     *                              queue depth, idle and lock wait time
+     *                              in, may be \c nullptr.
+     */
+    explicit Scheduler(::std::size_t threadCount,
+                       ::std::size_t maxThreadCount = 0,
+                       unsigned int  cpuCount       = 0,
+                       Stats        *stats          = nullptr) :
+        m_initial(::std::max<::std::size_t>(threadCount, 1)),
+        m_cpuCount(::std::max(cpuCount, 1u)), m_active(0), m_pending(0),
+        m_queued(0), m_sleepers(0), m_cancelled(false), m_stats(stats)
+    {
+        maxThreadCount = ::std::max(maxThreadCount, m_initial);
+        for (::std::size_t i = 0; i < maxThreadCount; ++i) {
+            m_deques.push_back(::std::make_unique<Deque>());
+        }
+        if (m_stats != nullptr) {
+            m_stats->watchQueue(&m_queued);
+        }
+    }
+
+    Scheduler(const Scheduler &)            = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    /**
+     * @brief       Destructor.
+     */
+    ~Scheduler()
+    {
+        if (m_stats != nullptr) {
+            m_stats->watchQueue(nullptr);
+        }
+    }
+
+    /**
+     * @brief       Get maximum number of workers.
+     *
+     * @return      Maximum number of workers, worker IDs are less than it.
+     */
+    inline ::std::size_t threadCount() const
+    {
+        return m_deques.size();
+    }
+
+    /**
+     * @brief       Get number of tasks queued and not started.
+     *
+     * @return      Number of tasks queued, may be stale.
+     */
+    inline ::std::size_t queued() const
+    {
+        return m_queued.load(::std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief       Add initial task, must be called before \c run().
+     *
+     * @param[in]   task        Task.
+     */
+    void push(Task &&task)
+    {
+        this->push(0, ::std::move(task));
+    }
+
+    /**
+     * @brief       Cancel, thread safe. Tasks queued are dropped at once and
+     *              tasks pushed later are ignored, tasks running are
+     *              finished.
+     */
+    void cancel()
+    {
+        m_cancelled.store(true);
+
+        ::std::size_t dropped = 0;
+        for (auto &deque : m_deques) {
+            auto lock = this->lock(*deque);
+            dropped += deque->tasks.size();
+            m_queued.fetch_sub(deque->tasks.size());
+            deque->tasks.clear();
+        }
+        this->finish(dropped);
+    }
+
+    /**
+     * @brief       Check if cancelled.
+     *
+     * @return      \c true if cancelled, \c false if not.
+     */
+    inline bool cancelled() const
+    {
+        return m_cancelled.load(::std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief       Run tasks until all tasks are finished.
+     *
+     * @param[in]   func        Task function, called as
+     *                          func(Worker &, Task &).
+     */
+    template<typename Func>
+    void run(Func &&func)
+    {
+        auto threadFunc = [&](::std::size_t id) -> void {
+            Worker worker(*this, id);
+            Task   task;
+            while (this->pop(id, task)) {
+                func(worker, task);
+                task = Task();
+                this->finish(1);
+            }
+        };
+
+        ::std::vector<::std::thread> threads;
+        for (::std::size_t i = 0; i < m_initial; ++i) {
+            ++m_active;
+            threads.push_back(::std::thread(threadFunc, i));
+        }
+
+        // Grow pool.
+        if (m_deques.size() > m_initial) {
+            auto lastWall = ::std::chrono::steady_clock::now();
+            auto lastCpu  = cpuTime();
+
+            ::std::unique_lock<::std::mutex> lock(m_sleepLock);
+            while (threads.size() < m_deques.size()
+                   && ! m_doneCond.wait_for(lock, GROW_INTERVAL, [this]() {
+                          return m_pending.load() == 0;
+                      })) {
+                auto wall = ::std::chrono::steady_clock::now();
+                auto cpu  = cpuTime();
+                auto busy = ::std::min<::std::size_t>(threads.size(),
+                                                      m_cpuCount);
+                double utilization
+                    = (cpu - lastCpu)
+                      / (::std::chrono::duration<double>(wall - lastWall)
+                             .count()
+                         * static_cast<double>(busy));
+                lastWall = wall;
+                lastCpu  = cpu;
+
+                if (m_queued.load() > 0 && m_sleepers.load() == 0
+                    && utilization < GROW_UTILIZATION) {
+                    ++m_active;
+                    threads.push_back(
+                        ::std::thread(threadFunc, threads.size()));
+                }
+            }
+        }
+
+        for (auto iter = threads.rbegin(); iter != threads.rend(); ++iter) {
+            iter->join();
+        }
+    }
+
+  private:
+    /**
+     * @brief       Push task to a deque.
+     *
+     * @param[in]   id          Worker ID.
+     * @param[in]   task        Task.
+     */
+    void push(::std::size_t id, Task &&task)
+    {
+        if (m_cancelled.load(::std::memory_order_relaxed)) {
+            return;
+        }
+
+        m_pending.fetch_add(1);
+        auto queued = m_queued.fetch_add(1) + 1;
+        if (m_stats != nullptr) {
+            m_stats->queued(queued);
+        }
+        {
+            auto &deque = *m_deques[id];
+            auto  lock  = this->lock(deque);
+            deque.tasks.push_back(::std::move(task));
+        }
+
+        if (m_sleepers.load() > 0) {
+            ::std::unique_lock<::std::mutex> lock(m_sleepLock);
+            m_sleepCond.notify_one();
+        }
+    }
+
+    /**
+     * @brief       Mark tasks finished, wake up everyone if none is left.
+     *
+     * @param[in]   count       Number of tasks.
+     */
+    void finish(::std::size_t count)
+    {
+        if (count > 0 && m_pending.fetch_sub(count) == count) {
+            ::std::unique_lock<::std::mutex> lock(m_sleepLock);
+            m_sleepCond.notify_all();
+            m_doneCond.notify_all();
+        }
+    }
+
+    /**
+     * @brief       Get next task, sleep if no task can be found.
+     *
+     * @param[in]   id          Worker ID.
+     * @param[out]  task        Task.
+     *
+     * @return      \c true if a task is got, \c false if all tasks finished.
+     */
+    bool pop(::std::size_t id, Task &task)
+    {
+        while (true) {
+            // Own deque, LIFO.
+            {
+                auto &deque = *m_deques[id];
+                auto  lock  = this->lock(deque);
+                if (! deque.tasks.empty()) {
+                    task = ::std::move(deque.tasks.back());
+                    deque.tasks.pop_back();
+                    m_queued.fetch_sub(1);
+                    return true;
+                }
+            }
+
+            // Steal, FIFO.
+            for (int round = 0; round < STEAL_ROUNDS; ++round) {
+                if (this->steal(id, task)) {
+                    return true;
+                }
+                if (m_pending.load() == 0) {
+                    return false;
+                }
+                ::std::this_thread::yield();
+            }
+
+            // Sleep.
+            ::std::unique_lock<::std::mutex> lock(m_sleepLock);
+            m_sleepers.fetch_add(1);
+            auto begin = m_stats != nullptr
+                             ? ::std::chrono::steady_clock::now()
+                             : ::std::chrono::steady_clock::time_point();
+            while (m_queued.load() == 0 && m_pending.load() != 0) {
+                m_sleepCond.wait(lock);
+            }
+            m_sleepers.fetch_sub(1);
+            if (m_stats != nullptr) {
+                Stats::add(m_stats->local().idleNs, elapsedNs(begin));
+            }
+            if (m_pending.load() == 0) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief       Steal task from other workers.
+     *
+     * @param[in]   id          Worker ID.
+     * @param[out]  task        Task.
+     *
+     * @return      \c true if a task is stolen, \c false if not.
+     */
+    bool steal(::std::size_t id, Task &task)
+    {
+        if (m_queued.load(::std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        auto active = m_active.load();
+        for (::std::size_t i = 1; i < active; ++i) {
+            auto &deque = *m_deques[(id + i) % active];
+            ::std::unique_lock<::std::mutex> lock(deque.lock,
+                                                  ::std::try_to_lock);
+            if (lock.owns_lock() && ! deque.tasks.empty()) {
+                task = ::std::move(deque.tasks.front());
+                deque.tasks.pop_front();
+                m_queued.fetch_sub(1);
+                if (m_stats != nullptr) {
+                    Stats::add(m_stats->local().steals);
+                }
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief       Lock deque, time the wait if contended.
+     *
+     * @param[in]   deque       Deque.
+     *
+     * @return      Lock.
+     */
+    ::std::unique_lock<::std::mutex> lock(Deque &deque)
+    {
+        ::std::unique_lock<::std::mutex> ret(deque.lock, ::std::try_to_lock);
+        if (! ret.owns_lock()) {
+            if (m_stats == nullptr) {
+                ret.lock();
+            } else {
+                auto begin = ::std::chrono::steady_clock::now();
+                ret.lock();
+                Stats::add(m_stats->local().lockWaitNs, elapsedNs(begin));
+            }
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief       Get nanoseconds elapsed.
+     *
+     * @param[in]   begin       Begin time.
+     *
+     * @return      Nanoseconds elapsed since \c begin.
+     */
+    static uint64_t elapsedNs(::std::chrono::steady_clock::time_point begin)
+    {
+        return static_cast<uint64_t>(
+            ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+                ::std::chrono::steady_clock::now() - begin)
+                .count());
+    }
+
+    /**
+     * @brief       Get CPU time used by the process.
+     *
+     * @return      CPU time in seconds.
+     */
+    static double cpuTime()
+    {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return static_cast<double>(ts.tv_sec)
+               + static_cast<double>(ts.tv_nsec) / 1e9;
+    }
+};
+
+} // namespace findlink
@@ -0,0 +1,410 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <findlink/stats.h>
+#include <findlink/target_set.h>
+#include <findlink/tracer.h>
+
+namespace findlink {
+
+/**
+ * @brief       Search engine.
+ */
+enum class SearchEngine {
+    THREADS, ///< Thread pool.
+    URING,   ///< io_uring, falls back to threads if not supported.
+};
+
+/**
+ * @brief       Search options.
+ */
+struct SearchOptions {
+    unsigned int threadCount    = 0; ///< Number of threads, 0 for auto.
+    unsigned int maxThreadCount = 0; ///< Maximum number of threads.
+    SearchEngine engine = SearchEngine::THREADS; ///< Search engine.
+    bool         under  = false; ///< Match links pointing under targets.
+
+    /// Pending directories to switch to depth-first, 0 for unbounded.
+    ::std::size_t maxPending = 0;
+
+    bool oneFileSystem = false; ///< Do not cross filesystems.
+    bool visitOnce     = false; ///< Scan each directory once.
+    bool statDirs      = false; ///< Stat directories, links carry dev.
+
+    /// Report each link once by dev, inode and resolved target.
+    bool dedupLinks = false;
+
+    /// Report links that cannot be resolved to the link callback of
+    /// \c traverse() too, with an empty \c linkedTo, besides the error.
+    bool reportUnresolved = false;
+
+    /// Patterns of directories excluded.
+    ::std::vector<::std::string> excludes;
+
+    /// Globs on canonical path of links, matched besides the targets.
+    ::std::vector<::std::string> targetGlobs;
+
+    /// Filesystem types whose mount points are skipped.
+    ::std::vector<::std::string> excludeFsTypes;
+
+    /// Devices of targets, directories on other devices than these and the
+    /// search directory are skipped if not empty.
+    ::std::vector<dev_t> targetDevs;
+
+    /// Device of the search directory, compared by \c oneFileSystem and
+    /// \c targetDevs, 0 for the device of the directory searched.
+    dev_t rootDev = 0;
+
+    /// Stats to count in, may be \c nullptr. Must outlive the search.
+    Stats *stats = nullptr;
+
+    /// Tracer to record latencies in, may be \c nullptr. Must outlive the
+    /// search, ignored unless tracing is compiled in.
+    Tracer *tracer = nullptr;
+};
+
+/**
+ * @brief       Symbol link searcher.
+ *
+ * Traverses a directory and reports links pointing to the targets, either
+ * to a callback called on the traversal threads, or in batches pulled by
+ * \c Results. Strings passed to callbacks are views of the traversal
+ * buffers and only valid during the call.
+ *
+ * A search stops early when a callback returns \c false or its cancellation
+ * flag is set. Workers check the flag between directory entries and the
+ * first one seeing it drops every directory queued.
+ */
+class Searcher {
+  public:
+    /**
+     * @brief       Link found.
+     */
+    struct Link {
+        ::std::string_view dir;      ///< Canonical directory.
+        ::std::string_view name;     ///< Name.
+        ::std::string_view raw;      ///< Raw link target.
+        ::std::string_view linkedTo; ///< Canonical path the link points to.
+        ::std::string_view matched;  ///< Target matched, empty if none.
+        uint64_t           dev;      ///< Device, 0 if unknown.
+        uint64_t           ino;      ///< Inode, 0 if unknown.
+
+        /**
+         * @brief       Get path of link.
+         *
+         * @return      Path.
+         */
+        ::std::string path() const;
+    };
+
+    /// Cancellation flag of a search, may be set from any thread.
+    using CancelFlag = ::std::atomic<bool>;
+
+    /**
+     * @brief       Link callback of traversal.
+     *
+     * Returns \c false to stop the traversal.
+     */
+    using LinkFunc = ::std::function<bool(const Link &)>;
+
+    /**
+     * @brief       Match callback.
+     *
+     * Returns \c false to stop the search.
+     */
+    using MatchFunc = ::std::function<bool(const Link &)>;
+
+    /// Error callback.
+    using ErrorFunc
+        = ::std::function<void(const ::std::filesystem::filesystem_error &)>;
+
+    /// Add subdirectory to traverse by name.
+    using PushDirFunc = ::std::function<void(::std::string_view)>;
+
+    /// Add link of directory by name and raw link target, without reading it.
+    using AddLinkFunc
+        = ::std::function<void(::std::string_view, const ::std::string &)>;
+
+    /**
+     * @brief       Directory callback of traversal.
+     *
+     * Called with the directory and its stat before it is scanned. Returns
+     * \c true if the callback reports the subdirectories and links of the
+     * directory itself, in which case it is not scanned.
+     */
+    using DirFunc = ::std::function<bool(const ::std::string &,
+                                         const struct stat &,
+                                         const PushDirFunc &,
+                                         const AddLinkFunc &)>;
+
+    /**
+     * @brief       Directory error callback of traversal.
+     *
+     * Called with a directory that cannot be opened or read, after the
+     * error callback.
+     */
+    using DirErrorFunc = ::std::function<void(const ::std::string &)>;
+
+    class Batch;
+    class Results;
+
+  private:
+    TargetSet     m_targets; ///< Canonical targets.
+    SearchOptions m_options; ///< Options.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   targets     Canonical targets.
+     * @param[in]   options     Options.
+     */
+    Searcher(TargetSet targets, SearchOptions options);
+
+    /**
+     * @brief       Get targets.
+     *
+     * @return      Targets.
+     */
+    inline const TargetSet &targets() const
+    {
+        return m_targets;
+    }
+
+    /**
+     * @brief       Get options.
+     *
+     * @return      Options.
+     */
+    inline const SearchOptions &options() const
+    {
+        return m_options;
+    }
+
+    /**
+     * @brief       Search links pointing to the targets.
+     *
+     * @param[in]   searchDir   Canonical directory to search.
+     * @param[in]   onMatch     Match callback, called on traversal threads.
+     * @param[in]   onError     Error callback, called on traversal threads.
+     * @param[in]   cancel      Cancellation flag, may be \c nullptr.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    void search(const ::std::filesystem::path &searchDir,
+                const MatchFunc               &onMatch,
+                const ErrorFunc               &onError,
+                CancelFlag                    *cancel = nullptr) const;
+
+    /**
+     * @brief       Traverse directory and resolve all links.
+     *
+     * @param[in]   searchDir   Canonical directory to traverse.
+     * @param[in]   onLink      Link callback, \c matched is empty.
+     * @param[in]   onError     Error callback.
+     * @param[in]   onDir       Directory callback, may be empty.
+     * @param[in]   onDirError  Directory error callback, may be empty.
+     * @param[in]   cancel      Cancellation flag, may be \c nullptr.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    void traverse(const ::std::filesystem::path &searchDir,
+                  const LinkFunc                &onLink,
+                  const ErrorFunc               &onError,
+                  const DirFunc                 &onDir      = nullptr,
+                  const DirErrorFunc            &onDirError = nullptr,
+                  CancelFlag                    *cancel     = nullptr) const;
+
+  private:
+    /**
+     * @brief       Traverse directory, instantiated on the link callback so
+     *              \c search() inlines its matcher.
+     *
+     * @param[in]   searchDir   Canonical directory to traverse.
+     * @param[in]   onLink      Link callback, \c matched is empty.
+     * @param[in]   onError     Error callback.
+     * @param[in]   onDir       Directory callback, may be empty.
+     * @param[in]   onDirError  Directory error callback, may be empty.
+     * @param[in]   cancel      Cancellation flag, may be \c nullptr.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    template<typename OnLink>
+    void traverseWith(const ::std::filesystem::path &searchDir,
+                      const OnLink                  &onLink,
+                      const ErrorFunc               &onError,
+                      const DirFunc                 &onDir,
+                      const DirErrorFunc            &onDirError,
+                      CancelFlag                    *cancel) const;
+};
+
+/**
+ * @brief       Batch of matches.
+ *
+ * Matches are packed in a single buffer, views returned are valid until the
+ * batch is cleared or reused, \c matched until the searcher is destroyed.
+ */
+class Searcher::Batch {
+  public:
+    /**
+     * @brief       Match.
+     */
+    struct Match {
+        ::std::string_view path;     ///< Link path.
+        ::std::string_view raw;      ///< Raw link target.
+        ::std::string_view linkedTo; ///< Canonical path the link points to.
+        ::std::string_view matched;  ///< Target matched.
+        uint64_t           dev;      ///< Device, 0 if unknown.
+        uint64_t           ino;      ///< Inode, 0 if unknown.
+    };
+
+  private:
+    /**
+     * @brief       Match packed.
+     */
+    struct Entry {
+        ::std::size_t      offset;       ///< Offset of strings in buffer.
+        uint32_t           pathSize;     ///< Size of path.
+        uint32_t           rawSize;      ///< Size of raw link target.
+        uint32_t           linkedToSize; ///< Size of resolved target.
+        ::std::string_view matched;      ///< Target matched.
+        uint64_t           dev;          ///< Device.
+        uint64_t           ino;          ///< Inode.
+    };
+
+  private:
+    ::std::string        m_data;    ///< Strings.
+    ::std::vector<Entry> m_entries; ///< Matches.
+
+  public:
+    /**
+     * @brief       Get number of matches.
+     *
+     * @return      Number of matches.
+     */
+    inline ::std::size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    /**
+     * @brief       Check if empty.
+     *
+     * @return      \c true if empty, \c false if not.
+     */
+    inline bool empty() const
+    {
+        return m_entries.empty();
+    }
+
+    /**
+     * @brief       Get match.
+     *
+     * @param[in]   index       Index.
+     *
+     * @return      Match.
+     */
+    Match operator[](::std::size_t index) const;
+
+    /**
+     * @brief       Add match.
+     *
+     * @param[in]   link        Link matched.
+     */
+    void add(const Link &link);
+
+    /**
+     * @brief       Remove all matches, the buffer is kept.
+     */
+    void clear();
+};
+
+/**
+ * @brief       Matches of a search pulled in batches.
+ *
+ * The search runs on its own threads from construction, matches are handed
+ * over in batches of \c batchSize and at most \c maxBatches batches wait
+ * for the consumer, beyond which traversal threads block. Destroying the
+ * results before the end cancels the search and waits for the traversal
+ * threads to return.
+ */
+class Searcher::Results {
+  private:
+    const Searcher           &m_searcher;   ///< Searcher.
+    ::std::filesystem::path   m_searchDir;  ///< Directory to search.
+    ErrorFunc                 m_onError;    ///< Error callback.
+    ::std::size_t             m_batchSize;  ///< Matches per batch.
+    ::std::size_t             m_maxBatches; ///< Batches waiting at most.
+    ::std::mutex              m_lock;       ///< Lock.
+    ::std::condition_variable m_cond;       ///< Batch ready or consumed.
+    Batch                     m_current;    ///< Batch filling.
+    ::std::deque<Batch>       m_batches;    ///< Batches ready.
+    bool                      m_done;       ///< Search finished.
+    bool                      m_closed;     ///< Consumer gone.
+    ::std::exception_ptr      m_error;      ///< Error ended the search.
+    CancelFlag                m_cancel;     ///< Cancellation flag.
+    ::std::thread             m_thread;     ///< Search thread.
+
+  public:
+    /**
+     * @brief       Constructor, start searching.
+     *
+     * @param[in]   searcher    Searcher, must outlive the results.
+     * @param[in]   searchDir   Canonical directory to search.
+     * @param[in]   onError     Error callback, called on traversal threads,
+     *                          may be empty.
+     * @param[in]   batchSize   Matches per batch.
+     * @param[in]   maxBatches  Batches waiting at most.
+     */
+    Results(const Searcher               &searcher,
+            const ::std::filesystem::path &searchDir,
+            const ErrorFunc               &onError    = nullptr,
+            ::std::size_t                  batchSize  = 256,
+            ::std::size_t                  maxBatches = 4);
+
+    Results(const Results &)            = delete;
+    Results &operator=(const Results &) = delete;
+
+    /**
+     * @brief       Destructor, stop consuming and wait for the search.
+     */
+    ~Results();
+
+    /**
+     * @brief       Get next batch, blocks until one is ready.
+     *
+     * @param[out]  batch       Batch, its old matches are replaced.
+     *
+     * @return      \c true if a batch is got, \c false at the end.
+     *
+     * @throw       ::std::filesystem::filesystem_error
+     */
+    bool next(Batch &batch);
+
+  private:
+    /**
+     * @brief       Add match, called on traversal threads.
+     *
+     * @param[in]   link        Link matched.
+     *
+     * @return      \c true to continue, \c false if the consumer is gone.
+     */
+    bool add(const Link &link);
+};
+
+} // namespace findlink
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <findlink/thread_slot.h>
+
+namespace findlink {
+
+/**
+ * @brief       Traversal metrics.
+ *
+ * Each thread counts in a cache-line aligned slot of its own, written only
+ * by that thread with relaxed loads and stores, so counting costs no locked
+ * instruction and no shared cache line. Slots are summed when a snapshot is
+ * taken, which may happen while threads are running.
+ */
+class Stats {
+  public:
+    /// Counter written by a single thread.
+    using Counter = ::std::atomic<uint64_t>;
+
+    /// Errors with errno not less than it are counted as errno 0.
+    static constexpr ::std::size_t ERRNO_COUNT = 160;
+
+    /**
+     * @brief       Counters of a thread.
+     */
+    struct alignas(64) Slot {
+        Counter dirs {0};            ///< Directories scanned.
+        Counter entries {0};         ///< Directory entries seen.
+        Counter splits {0};          ///< Batches of directories split off.
+        Counter links {0};           ///< Links read.
+        Counter matched {0};         ///< Links matched.
+        Counter resolveSyscalls {0}; ///< lstat and readlink of resolver.
+        Counter prefixHits {0};      ///< Prefix cache hits of resolver.
+        Counter linkHits {0};        ///< Link cache hits of resolver.
+        Counter linkMisses {0};      ///< Links read by resolver.
+        Counter idleNs {0};          ///< Time sleeping without task.
+        Counter lockWaitNs {0};      ///< Time waiting for contended locks.
+        Counter steals {0};          ///< Tasks stolen.
+
+        /// Errors by errno.
+        ::std::array<Counter, ERRNO_COUNT> errors {};
+    };
+
+    /**
+     * @brief       Sum of all slots.
+     */
+    struct Snapshot {
+        double   elapsed;         ///< Seconds since created.
+        uint64_t dirs;            ///< Directories scanned.
+        uint64_t entries;         ///< Directory entries seen.
+        uint64_t splits;          ///< Batches of directories split off.
+        uint64_t links;           ///< Links read.
+        uint64_t matched;         ///< Links matched.
+        uint64_t resolveSyscalls; ///< lstat and readlink of resolver.
+        uint64_t prefixHits;      ///< Prefix cache hits of resolver.
+        uint64_t linkHits;        ///< Link cache hits of resolver.
+        uint64_t linkMisses;      ///< Links read by resolver.
+        uint64_t idleNs;          ///< Time sleeping without task.
+        uint64_t lockWaitNs;      ///< Time waiting for contended locks.
+        uint64_t steals;          ///< Tasks stolen.
+        uint64_t queueHighWater;  ///< Maximum tasks queued.
+        uint64_t queueDepth;      ///< Tasks queued now.
+        uint64_t threads;         ///< Threads counted.
+
+        /// Errors by errno, (errno, count).
+        ::std::vector<::std::pair<int, uint64_t>> errors;
+    };
+
+  private:
+    using Clock = ::std::chrono::steady_clock;
+
+  private:
+    Clock::time_point    m_begin;          ///< Creation time.
+    Counter              m_queueHighWater; ///< Maximum tasks queued.
+    mutable ::std::mutex m_lock;           ///< Lock of queue.
+
+    /// Tasks queued of the running scheduler, \c nullptr if none.
+    const ::std::atomic<::std::size_t> *m_queueDepth;
+
+    ThreadSlots<Slot> m_slots; ///< Slots of threads.
+
+  public:
+    /**
+     * @brief       Constructor.
+     */
+    Stats();
+
+    Stats(const Stats &)            = delete;
+    Stats &operator=(const Stats &) = delete;
+
+    /**
+     * @brief       Add to counter of current thread.
+     *
+     * @param[in]   counter     Counter.
+     * @param[in]   value       Value to add.
+     */
+    static inline void add(Counter &counter, uint64_t value = 1)
+    {
+        counter.store(counter.load(::std::memory_order_relaxed) + value,
+                      ::std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief       Get slot of current thread.
+     *
+     * @return      Slot.
+     */
+    inline Slot &local()
+    {
+        return m_slots.local();
+    }
+
+    /**
+     * @brief       Count error of current thread.
+     *
+     * @param[in]   err         Error number.
+     */
+    inline void error(int err)
+    {
+        auto index = static_cast<::std::size_t>(err);
+        add(this->local().errors[index < ERRNO_COUNT ? index : 0]);
+    }
+
+    /**
+     * @brief       Update queue high water mark, thread safe.
+     *
+     * @param[in]   queued      Tasks queued.
+     */
+    inline void queued(uint64_t queued)
+    {
+        auto current = m_queueHighWater.load(::std::memory_order_relaxed);
+        while (queued > current
+               && ! m_queueHighWater.compare_exchange_weak(
+                   current, queued, ::std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief       Set counter of tasks queued read by snapshots, thread safe.
+     *
+     * @param[in]   queued      Counter, \c nullptr to unset. Must stay
+     *                          valid until unset.
+     */
+    void watchQueue(const ::std::atomic<::std::size_t> *queued);
+
+    /**
+     * @brief       Take snapshot, thread safe.
+     *
+     * @return      Snapshot.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief       Format snapshot, one "name value" per line.
+     *
+     * @param[in]   snapshot    Snapshot.
+     *
+     * @return      Text.
+     */
+    static ::std::string format(const Snapshot &snapshot);
+
+    /**
+     * @brief       Format snapshot as a one line progress status.
+     *
+     * @param[in]   snapshot    Snapshot.
+     * @param[in]   last        Snapshot of last status, for rates.
+     *
+     * @return      Text, without newline.
+     */
+    static ::std::string formatProgress(const Snapshot &snapshot,
+                                        const Snapshot &last);
+};
+
+} // namespace findlink
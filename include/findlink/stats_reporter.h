@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include <findlink/stats.h>
+
+namespace findlink {
+
+/**
+ * @brief       Reporter of stats.
+ *
+ * Exports snapshots to a file periodically while alive, the file is replaced
+ * atomically so a monitor never reads a partial one. The last snapshot is
+ * exported, and printed to stderr if asked, when the reporter is destroyed.
+ *
+ * A progress status may be printed to stderr at each interval too, redrawn
+ * in place on a terminal. Snapshots only read the relaxed counters of the
+ * workers, so the traversal never waits for the reporter.
+ */
+class StatsReporter {
+  private:
+    Stats                      &m_stats;    ///< Stats.
+    ::std::filesystem::path     m_path;     ///< Export file, empty for none.
+    ::std::chrono::milliseconds m_interval; ///< Export interval.
+    bool                        m_print;    ///< Print summary at end.
+    bool                        m_progress; ///< Print progress status.
+    bool                        m_terminal; ///< Stderr is a terminal.
+    Stats::Snapshot             m_last;     ///< Snapshot of last status.
+    bool                        m_stop;     ///< Stop exporting.
+    ::std::mutex                m_lock;     ///< Lock.
+    ::std::condition_variable   m_cond;     ///< Stop condition.
+    ::std::thread               m_thread;   ///< Export thread.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   stats       Stats, must outlive the reporter.
+     * @param[in]   path        Export file, empty for none.
+     * @param[in]   interval    Export interval.
+     * @param[in]   print       Print summary to stderr at end.
+     * @param[in]   progress    Print progress status to stderr at each
+     *                          interval.
+     */
+    StatsReporter(Stats                        &stats,
+                  const ::std::filesystem::path &path,
+                  ::std::chrono::milliseconds    interval,
+                  bool                           print,
+                  bool                           progress = false);
+
+    StatsReporter(const StatsReporter &)            = delete;
+    StatsReporter &operator=(const StatsReporter &) = delete;
+
+    /**
+     * @brief       Destructor, report last snapshot.
+     */
+    ~StatsReporter();
+
+  private:
+    /**
+     * @brief       Export snapshot to file.
+     *
+     * @param[in]   text        Formatted snapshot.
+     */
+    void exportFile(const ::std::string &text);
+
+    /**
+     * @brief       Print progress status.
+     *
+     * @param[in]   snapshot    Snapshot.
+     */
+    void printProgress(const Stats::Snapshot &snapshot);
+};
+
+} // namespace findlink
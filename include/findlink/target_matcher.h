@@ -0,0 +1,174 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <findlink/byte_string.h>
+#include <findlink/target_set.h>
+
+namespace findlink {
+
+// Matchers of resolved link targets. Each matcher is a small value type
+// whose call operator takes a canonical path and returns the target or
+// pattern matched, nullptr if none. The search kernel is instantiated once
+// per matcher type, so the check of each link is inlined instead of going
+// through a function object.
+
+/**
+ * @brief       Matcher of links pointing to a single target.
+ */
+class SingleTargetMatcher {
+  private:
+    const ::std::string &m_target; ///< Target.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   targets     Targets, must hold exactly one.
+     */
+    explicit SingleTargetMatcher(const TargetSet &targets) :
+        m_target(*targets.begin())
+    {}
+
+    /**
+     * @brief       Match path.
+     *
+     * @param[in]   path        Canonical path.
+     *
+     * @return      Target matched, \c nullptr if none.
+     */
+    inline const ::std::string *operator()(::std::string_view path) const
+    {
+        return pathEqual(path, m_target) ? &m_target : nullptr;
+    }
+};
+
+/**
+ * @brief       Matcher of links pointing to or under a single target.
+ */
+class SingleUnderMatcher {
+  private:
+    const ::std::string &m_target; ///< Target.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   targets     Targets, must hold exactly one.
+     */
+    explicit SingleUnderMatcher(const TargetSet &targets) :
+        m_target(*targets.begin())
+    {}
+
+    /**
+     * @brief       Match path.
+     *
+     * @param[in]   path        Canonical path.
+     *
+     * @return      Target matched, \c nullptr if none.
+     */
+    inline const ::std::string *operator()(::std::string_view path) const
+    {
+        return isPathPrefix(path, m_target) ? &m_target : nullptr;
+    }
+};
+
+/**
+ * @brief       Matcher of links pointing to any of the targets.
+ */
+class TargetSetMatcher {
+  private:
+    const TargetSet &m_targets; ///< Targets.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   targets     Targets.
+     */
+    explicit TargetSetMatcher(const TargetSet &targets) : m_targets(targets)
+    {}
+
+    /**
+     * @brief       Match path.
+     *
+     * @param[in]   path        Canonical path.
+     *
+     * @return      Target matched, \c nullptr if none.
+     */
+    inline const ::std::string *operator()(::std::string_view path) const
+    {
+        return m_targets.find(path);
+    }
+};
+
+/**
+ * @brief       Matcher of links pointing to or under any of the targets.
+ */
+class TargetSetUnderMatcher {
+  private:
+    const TargetSet &m_targets; ///< Targets.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   targets     Targets.
+     */
+    explicit TargetSetUnderMatcher(const TargetSet &targets) :
+        m_targets(targets)
+    {}
+
+    /**
+     * @brief       Match path.
+     *
+     * @param[in]   path        Canonical path.
+     *
+     * @return      Deepest target matched, \c nullptr if none.
+     */
+    inline const ::std::string *operator()(::std::string_view path) const
+    {
+        return m_targets.findUnder(path);
+    }
+};
+
+/**
+ * @brief       Matcher of links pointing to the targets or to paths
+ *              matching globs.
+ *
+ * Globs are matched by \c fnmatch() against the whole canonical path, '*'
+ * matches '/' too. Targets are checked first.
+ */
+class GlobMatcher {
+  private:
+    const TargetSet                    &m_targets; ///< Targets.
+    const ::std::vector<::std::string> &m_globs;   ///< Globs.
+    bool                                m_under;   ///< Match under too.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   targets     Targets.
+     * @param[in]   globs       Globs.
+     * @param[in]   under       Match paths under the targets and globs too.
+     */
+    GlobMatcher(const TargetSet                    &targets,
+                const ::std::vector<::std::string> &globs,
+                bool                                under) :
+        m_targets(targets), m_globs(globs), m_under(under)
+    {}
+
+    /**
+     * @brief       Match path.
+     *
+     * @param[in]   path        Canonical path.
+     *
+     * @return      Target or glob matched, \c nullptr if none.
+     */
+    const ::std::string *operator()(::std::string_view path) const;
+};
+
+} // namespace findlink
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <findlink/byte_string.h>
+
+namespace findlink {
+
+/**
+ * @brief       Set of canonical link targets.
+ *
+ * Besides the targets themselves, the set keeps every ancestor directory of
+ * the targets, which are known to be canonical directories and let the
+ * resolver skip syscalls for them.
+ */
+class TargetSet {
+  private:
+    using Set = ::std::unordered_set<::std::string, PathHash, PathEqual>;
+
+  private:
+    Set                 m_targets;   ///< Targets.
+    Set                 m_ancestors; ///< Ancestor directories of targets.
+    ::std::vector<bool> m_lengths;   ///< Lengths of targets.
+
+  public:
+    /**
+     * @brief       Add target.
+     *
+     * @param[in]   target      Canonical target.
+     */
+    void add(const ::std::string &target);
+
+    /**
+     * @brief       Get number of targets.
+     *
+     * @return      Number of targets.
+     */
+    inline ::std::size_t size() const
+    {
+        return m_targets.size();
+    }
+
+    /**
+     * @brief       Check if empty.
+     *
+     * @return      \c true if empty, \c false if not.
+     */
+    inline bool empty() const
+    {
+        return m_targets.empty();
+    }
+
+    /**
+     * @brief       Find target.
+     *
+     * @param[in]   path        Canonical path.
+     *
+     * @return      Matched target, \c nullptr if not found.
+     */
+    inline const ::std::string *find(::std::string_view path) const
+    {
+        auto iter = m_targets.find(path);
+        return iter == m_targets.end() ? nullptr : &*iter;
+    }
+
+    /**
+     * @brief       Find the deepest target which is the path itself or one of
+     *              its ancestors.
+     *
+     * @param[in]   path        Canonical path.
+     *
+     * @return      Matched target, \c nullptr if not found.
+     */
+    const ::std::string *findUnder(::std::string_view path) const;
+
+    /**
+     * @brief       Check if the path is an ancestor directory of a target.
+     *
+     * @param[in]   path        Canonical path.
+     *
+     * @return      \c true if ancestor, \c false if not.
+     */
+    inline bool isAncestor(::std::string_view path) const
+    {
+        return m_ancestors.find(path) != m_ancestors.end();
+    }
+
+    /**
+     * @brief       Iterate targets.
+     */
+    inline Set::const_iterator begin() const
+    {
+        return m_targets.begin();
+    }
+
+    /**
+     * @brief       Iterate targets.
+     */
+    inline Set::const_iterator end() const
+    {
+        return m_targets.end();
+    }
+};
+
+} // namespace findlink
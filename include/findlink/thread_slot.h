@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace findlink {
+
+/**
+ * @brief       Slots of threads, one per thread using the owner.
+ *
+ * A thread finds its slot through a thread_local cache tagged by the ID of
+ * the owner, without locking. IDs are never reused, so a cache left by a
+ * destroyed owner never matches a new one. The cache holds the last owner
+ * used, on a miss the slot of the thread is looked up under the lock, so a
+ * thread switching between owners reuses its slots. Slots live as long as
+ * the owner and are visited under a lock.
+ *
+ * @tparam      T           Slot type.
+ */
+template<typename T>
+class ThreadSlots {
+  private:
+    /**
+     * @brief       Slot cache of a thread.
+     */
+    struct Cache {
+        uint64_t id   = 0;       ///< ID of the owner of the slot.
+        T       *slot = nullptr; ///< Slot.
+    };
+
+  private:
+    static inline ::std::atomic<uint64_t> nextId {1}; ///< Next owner ID.
+    static inline thread_local Cache      cache;      ///< Slot cache.
+
+  private:
+    uint64_t                            m_id;    ///< Owner ID.
+    mutable ::std::mutex                m_lock;  ///< Lock of slots.
+    ::std::vector<::std::unique_ptr<T>> m_slots; ///< Slots.
+
+    /// Slots by thread.
+    ::std::unordered_map<::std::thread::id, T *> m_threads;
+
+  public:
+    /**
+     * @brief       Constructor.
+     */
+    ThreadSlots() : m_id(nextId.fetch_add(1, ::std::memory_order_relaxed)) {}
+
+    ThreadSlots(const ThreadSlots &)            = delete;
+    ThreadSlots &operator=(const ThreadSlots &) = delete;
+
+    /**
+     * @brief       Get slot of current thread, created on first use.
+     *
+     * @param[in]   init        Called with a new slot and its index under
+     *                          the lock, not called for a slot of the
+     *                          thread found.
+     *
+     * @return      Slot.
+     */
+    template<typename Init>
+    inline T &local(const Init &init)
+    {
+        if (cache.id == m_id) {
+            return *cache.slot;
+        }
+
+        ::std::unique_lock<::std::mutex> lock(m_lock);
+        auto &ret = m_threads[::std::this_thread::get_id()];
+        if (ret == nullptr) {
+            auto slot = ::std::make_unique<T>();
+            init(*slot, m_slots.size());
+            m_slots.push_back(::std::move(slot));
+            ret = m_slots.back().get();
+        }
+        cache.id   = m_id;
+        cache.slot = ret;
+
+        return *ret;
+    }
+
+    /**
+     * @brief       Get slot of current thread, created on first use.
+     *
+     * @return      Slot.
+     */
+    inline T &local()
+    {
+        return this->local([](T &, ::std::size_t) -> void {});
+    }
+
+    /**
+     * @brief       Visit all slots under the lock.
+     *
+     * @param[in]   func        Called with each slot.
+     */
+    template<typename Func>
+    void forEach(const Func &func)
+    {
+        ::std::unique_lock<::std::mutex> lock(m_lock);
+        for (auto &slot : m_slots) {
+            func(*slot);
+        }
+    }
+
+    /**
+     * @brief       Visit all slots under the lock.
+     *
+     * @param[in]   func        Called with each slot.
+     */
+    template<typename Func>
+    void forEach(const Func &func) const
+    {
+        ::std::unique_lock<::std::mutex> lock(m_lock);
+        for (auto &slot : m_slots) {
+            func(*slot);
+        }
+    }
+
+    /**
+     * @brief       Get number of slots.
+     *
+     * @return      Number of slots.
+     */
+    ::std::size_t size() const
+    {
+        ::std::unique_lock<::std::mutex> lock(m_lock);
+        return m_slots.size();
+    }
+};
+
+} // namespace findlink
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <findlink/thread_slot.h>
+
+namespace findlink {
+
+/**
+ * @brief       Operation traced.
+ */
+enum class TraceKind {
+    DIR,      ///< Search task of a directory.
+    READLINK, ///< Read of a link found.
+    RESOLVE,  ///< Resolution of the links of a scanned batch.
+};
+
+/**
+ * @brief       Tracer of latencies.
+ *
+ * Latencies are recorded in per-thread log-linear histograms: each power of
+ * 2 of nanoseconds is split into 8 buckets, so percentiles are within 12.5%.
+ * Each thread also keeps the slowest directories it scanned, and operations
+ * slower than a threshold as events of a Chrome trace-event file.
+ *
+ * Hooks are only compiled in when \c FINDLINK_TRACING is defined, by the
+ * CMake option \c ENABLE_TRACING. Otherwise \c TraceScope is empty and the
+ * tracer never records anything.
+ */
+class Tracer {
+  public:
+    using Clock = ::std::chrono::steady_clock;
+
+    /// Hooks compiled in.
+#if defined(FINDLINK_TRACING)
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    /// Number of operations traced.
+    static constexpr ::std::size_t KIND_COUNT = 3;
+
+  private:
+    /// Bits of buckets in each power of 2.
+    static constexpr unsigned int SUB_BITS = 3;
+
+    /// Number of buckets.
+    static constexpr ::std::size_t BUCKET_COUNT = (64 - SUB_BITS + 1)
+                                                  << SUB_BITS;
+
+    /// Events kept by a thread at most, later ones are dropped.
+    static constexpr ::std::size_t MAX_EVENTS = 100000;
+
+  public:
+    /**
+     * @brief       Histogram of latencies in nanoseconds.
+     */
+    class Histogram {
+      private:
+        ::std::array<uint64_t, BUCKET_COUNT> m_buckets {}; ///< Buckets.
+        uint64_t                             m_count = 0;  ///< Count.
+        uint64_t                             m_sum   = 0;  ///< Sum.
+        uint64_t                             m_max   = 0;  ///< Maximum.
+
+      public:
+        /**
+         * @brief       Add value.
+         *
+         * @param[in]   value       Nanoseconds.
+         */
+        void add(uint64_t value);
+
+        /**
+         * @brief       Add values of another histogram.
+         *
+         * @param[in]   other       Histogram.
+         */
+        void merge(const Histogram &other);
+
+        /**
+         * @brief       Get count of values.
+         *
+         * @return      Count.
+         */
+        inline uint64_t count() const
+        {
+            return m_count;
+        }
+
+        /**
+         * @brief       Get mean value.
+         *
+         * @return      Nanoseconds, 0 if empty.
+         */
+        inline uint64_t mean() const
+        {
+            return m_count > 0 ? m_sum / m_count : 0;
+        }
+
+        /**
+         * @brief       Get maximum value.
+         *
+         * @return      Nanoseconds.
+         */
+        inline uint64_t max() const
+        {
+            return m_max;
+        }
+
+        /**
+         * @brief       Get percentile.
+         *
+         * @param[in]   quantile    Quantile in [0, 1].
+         *
+         * @return      Nanoseconds, middle of the bucket holding it.
+         */
+        uint64_t percentile(double quantile) const;
+    };
+
+    /**
+     * @brief       Operation recorded.
+     */
+    struct Event {
+        ::std::string name;     ///< Path.
+        TraceKind     kind;     ///< Operation.
+        uint64_t      begin;    ///< Nanoseconds since tracer created.
+        uint64_t      duration; ///< Nanoseconds.
+        uint32_t      thread;   ///< Thread index.
+    };
+
+    /**
+     * @brief       Records of a thread.
+     */
+    struct Slot {
+        uint32_t thread; ///< Thread index.
+
+        /// Histograms by operation.
+        ::std::array<Histogram, KIND_COUNT> histograms;
+
+        ::std::vector<Event> slowest; ///< Slowest directories, min-heap.
+        ::std::vector<Event> events;  ///< Slow operations.
+    };
+
+  private:
+    Clock::time_point          m_begin;    ///< Creation time.
+    ::std::size_t              m_topCount; ///< Slowest directories kept.
+    ::std::chrono::nanoseconds m_eventMin; ///< Duration of events at least.
+    ThreadSlots<Slot>          m_slots;    ///< Slots of threads.
+
+  public:
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   topCount    Slowest directories kept.
+     * @param[in]   eventMin    Operations at least this long are kept as
+     *                          events.
+     */
+    Tracer(::std::size_t topCount, ::std::chrono::nanoseconds eventMin);
+
+    Tracer(const Tracer &)            = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    /**
+     * @brief       Record operation of current thread.
+     *
+     * @param[in]   kind        Operation.
+     * @param[in]   dir         Directory.
+     * @param[in]   name        Entry name, empty for the directory itself.
+     * @param[in]   begin       Time began, ended now.
+     */
+    void record(TraceKind          kind,
+                ::std::string_view dir,
+                ::std::string_view name,
+                Clock::time_point  begin);
+
+    /**
+     * @brief       Format latency histograms and slowest directories, call
+     *              when no thread records anymore.
+     *
+     * @return      Text.
+     */
+    ::std::string summary() const;
+
+    /**
+     * @brief       Write events as a Chrome trace-event JSON file, call when
+     *              no thread records anymore.
+     *
+     * @param[in]   path        Path of file.
+     *
+     * @return      \c true on success, \c false if failed to write.
+     */
+    bool writeTrace(const ::std::filesystem::path &path) const;
+
+  private:
+    /**
+     * @brief       Get slot of current thread.
+     *
+     * @return      Slot.
+     */
+    Slot &local();
+};
+
+#if defined(FINDLINK_TRACING)
+
+/**
+ * @brief       Scope recording its lifetime as an operation.
+ */
+class TraceScope {
+  private:
+    Tracer                   *m_tracer; ///< Tracer, \c nullptr for none.
+    TraceKind                 m_kind;   ///< Operation.
+    ::std::string_view        m_dir;    ///< Directory.
+    ::std::string_view        m_name;   ///< Entry name.
+    Tracer::Clock::time_point m_begin;  ///< Time began.
+
+  public:
+    /**
+     * @brief       Constructor, begin operation.
+     *
+     * @param[in]   tracer      Tracer, \c nullptr for none.
+     * @param[in]   kind        Operation.
+     * @param[in]   dir         Directory, must outlive the scope.
+     * @param[in]   name        Entry name, must outlive the scope.
+     */
+    inline TraceScope(Tracer            *tracer,
+                      TraceKind          kind,
+                      ::std::string_view dir,
+                      ::std::string_view name = {}) :
+        m_tracer(tracer), m_kind(kind), m_dir(dir), m_name(name)
+    {
+        if (m_tracer != nullptr) {
+            m_begin = Tracer::Clock::now();
+        }
+    }
+
+    TraceScope(const TraceScope &)            = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    /**
+     * @brief       Destructor, end operation.
+     */
+    inline ~TraceScope()
+    {
+        if (m_tracer != nullptr) {
+            m_tracer->record(m_kind, m_dir, m_name, m_begin);
+        }
+    }
+};
+
+#else
+
+/**
+ * @brief       Scope recording nothing, tracing is compiled out.
+ */
+class TraceScope {
+  public:
+    inline TraceScope(Tracer *,
+                      TraceKind,
+                      ::std::string_view,
+                      ::std::string_view = {})
+    {}
+
+    TraceScope(const TraceScope &)            = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+};
+
+#endif
+
+/**
+ * @brief       Call function as an operation traced.
+ *
+ * @param[in]   tracer      Tracer, \c nullptr for none.
+ * @param[in]   kind        Operation.
+ * @param[in]   dir         Directory.
+ * @param[in]   name        Entry name.
+ * @param[in]   func        Function.
+ *
+ * @return      Value returned by \c func.
+ */
+template<typename Func>
+inline auto traced(Tracer            *tracer,
+                   TraceKind          kind,
+                   ::std::string_view dir,
+                   ::std::string_view name,
+                   Func             &&func)
+{
+    TraceScope scope(tracer, kind, dir, name);
+    return func();
+}
+
+} // namespace findlink
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+#include <findlink/dir_scanner.h>
+
+namespace findlink {
+
+/**
+ * @brief       io_uring traversal engine.
+ *
+ * A single thread keeps up to \c depth directory opens in flight through
+ * io_uring, and scans each directory as soon as its open completes. The
+ * kernel has no io_uring opcodes for getdents64 or readlinkat, so those are
+ * still issued by \c DirScanner synchronously on the opened fd.
+ */
+class UringEngine {
+  public:
+    /// Scan function, called for each directory opened.
+    using ScanFunc = ::std::function<void(DirScanner &)>;
+
+    /// Error function, called for each directory failed to open.
+    using ErrorFunc
+        = ::std::function<void(const ::std::filesystem::filesystem_error &)>;
+
+  private:
+    /// Queued requests submitted without waiting while scanning.
+    static constexpr unsigned int SUBMIT_BATCH = 16;
+
+  private:
+    int          m_ringFd;   ///< Ring fd.
+    unsigned int m_depth;    ///< Maximum requests in flight.
+    unsigned int m_inFlight; ///< Requests in flight.
+
+    // Submission queue.
+    void          *m_sqRing;     ///< Mapped ring.
+    ::std::size_t  m_sqRingSize; ///< Size of mapped ring.
+    unsigned int  *m_sqHead;     ///< Head.
+    unsigned int  *m_sqTail;     ///< Tail.
+    unsigned int  *m_sqMask;     ///< Mask.
+    unsigned int  *m_sqArray;    ///< Index array.
+    io_uring_sqe  *m_sqes;       ///< Entries.
+    ::std::size_t  m_sqesSize;   ///< Size of mapped entries.
+    unsigned int   m_toSubmit;   ///< Entries not submitted.
+
+    // Completion queue.
+    void          *m_cqRing;     ///< Mapped ring, may equal \c m_sqRing.
+    ::std::size_t  m_cqRingSize; ///< Size of mapped ring.
+    unsigned int  *m_cqHead;     ///< Head.
+    unsigned int  *m_cqTail;     ///< Tail.
+    unsigned int  *m_cqMask;     ///< Mask.
+    io_uring_cqe  *m_cqes;       ///< Entries.
+
+    ::std::vector<::std::string> m_pending;   ///< Directories to open.
+    ::std::atomic<bool>          m_cancelled; ///< Cancelled.
+
+  public:
+    /**
+     * @brief       Check if the kernel supports the engine.
+     *
+     * @return      \c true if supported, \c false if not.
+     */
+    static bool supported();
+
+    /**
+     * @brief       Constructor.
+     *
+     * @param[in]   depth       Maximum requests in flight.
+     *
+     * @throw       ::std::system_error
+     */
+    explicit UringEngine(unsigned int depth);
+
+    UringEngine(const UringEngine &)            = delete;
+    UringEngine &operator=(const UringEngine &) = delete;
+
+    /**
+     * @brief       Destructor.
+     */
+    ~UringEngine();
+
+    /**
+     * @brief       Add directory to scan.
+     *
+     * @param[in]   dir         Directory.
+     */
+    void push(::std::string dir);
+
+    /**
+     * @brief       Get number of directories waiting to be opened.
+     *
+     * @return      Number of directories.
+     */
+    inline ::std::size_t pending() const
+    {
+        return m_pending.size();
+    }
+
+    /**
+     * @brief       Cancel, thread safe. Directories pending are dropped,
+     *              directories being opened are closed without scanning.
+     */
+    inline void cancel()
+    {
+        m_cancelled.store(true, ::std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief       Run until all directories are scanned.
+     *
+     * @param[in]   scan        Scan function.
+     * @param[in]   error       Error function.
+     *
+     * @throw       ::std::system_error
+     */
+    void run(const ScanFunc &scan, const ErrorFunc &error);
+
+  private:
+    /**
+     * @brief       Release ring.
+     */
+    void release();
+
+    /**
+     * @brief       Queue open requests of pending directories.
+     */
+    void queueOpens();
+
+    /**
+     * @brief       Submit queued requests.
+     *
+     * @param[in]   wait        Wait for at least one completion.
+     *
+     * @throw       ::std::system_error
+     */
+    void submit(bool wait);
+};
+
+} // namespace findlink
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h>
+
+#include <findlink/concurrent_map.h>
+
+namespace findlink {
+
+/**
+ * @brief       Set of visited files by (dev, ino).
+ *
+ * A directory reachable through several paths, by bind mounts or overlay
+ * layers, is visited only through the first path seen. The set is sharded,
+ * so threads visiting different files rarely share a lock.
+ */
+class VisitedSet {
+  private:
+    /**
+     * @brief       File ID.
+     */
+    struct FileId {
+        uint64_t dev; ///< Device.
+        uint64_t ino; ///< Inode.
+
+        inline bool operator==(const FileId &other) const
+        {
+            return dev == other.dev && ino == other.ino;
+        }
+    };
+
+    /**
+     * @brief       Hash of file ID.
+     */
+    struct Hash {
+        inline ::std::size_t operator()(const FileId &id) const
+        {
+            auto dev = (id.dev << 32) | (id.dev >> 32);
+            return static_cast<::std::size_t>((id.ino * 0x9E3779B97F4A7C15ULL)
+                                              ^ dev);
+        }
+    };
+
+  private:
+    ConcurrentMap<FileId, bool, Hash> m_visited; ///< Visited files.
+
+  public:
+    /**
+     * @brief       Mark directory visited, thread safe.
+     *
+     * @param[in]   st          Stat of directory.
+     *
+     * @return      \c true if first visited, \c false if visited before.
+     */
+    inline bool visit(const struct stat &st)
+    {
+        return m_visited.insert(FileId {static_cast<uint64_t>(st.st_dev),
+                                        static_cast<uint64_t>(st.st_ino)},
+                                true);
+    }
+
+    /**
+     * @brief       Get number of files visited.
+     *
+     * @return      Number of files visited.
+     */
+    inline ::std::size_t size() const
+    {
+        return m_visited.size();
+    }
+};
+
+/**
+ * @brief       Set of visited links by (dev, ino) and resolved target.
+ *
+ * A link reachable through bind mounts is reported only through the first
+ * path seen. Hard links of a relative link resolve against the directory of
+ * each name, so they are the same link only if they resolve to the same
+ * target.
+ */
+class VisitedLinkSet {
+  private:
+    /**
+     * @brief       Link ID.
+     */
+    struct LinkId {
+        uint64_t      dev;      ///< Device.
+        uint64_t      ino;      ///< Inode.
+        ::std::string linkedTo; ///< Resolved target.
+
+        inline bool operator==(const LinkId &other) const
+        {
+            return dev == other.dev && ino == other.ino
+                   && linkedTo == other.linkedTo;
+        }
+    };
+
+    /**
+     * @brief       Hash of link ID.
+     */
+    struct Hash {
+        inline ::std::size_t operator()(const LinkId &id) const
+        {
+            auto dev = (id.dev << 32) | (id.dev >> 32);
+            return static_cast<::std::size_t>((id.ino * 0x9E3779B97F4A7C15ULL)
+                                              ^ dev)
+                   ^ ::std::hash<::std::string> {}(id.linkedTo);
+        }
+    };
+
+  private:
+    ConcurrentMap<LinkId, bool, Hash> m_visited; ///< Visited links.
+
+  public:
+    /**
+     * @brief       Mark link visited, thread safe.
+     *
+     * @param[in]   dev         Device.
+     * @param[in]   ino         Inode.
+     * @param[in]   linkedTo    Resolved target.
+     *
+     * @return      \c true if first visited, \c false if visited before.
+     */
+    inline bool visit(uint64_t dev, uint64_t ino, ::std::string_view linkedTo)
+    {
+        return m_visited.insert(LinkId {dev, ino, ::std::string(linkedTo)},
+                                true);
+    }
+
+    /**
+     * @brief       Get number of links visited.
+     *
+     * @return      Number of links visited.
+     */
+    inline ::std::size_t size() const
+    {
+        return m_visited.size();
+    }
+};
+
+} // namespace findlink
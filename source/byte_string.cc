@@ -0,0 +1,300 @@
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#elif defined(__aarch64__)
+    #include <arm_neon.h>
+#endif
+
+#include <findlink/byte_string.h>
+
+namespace findlink {
+
+namespace {
+
+/**
+ * @brief       Functions of an instruction set.
+ */
+struct Functions {
+    SimdLevel level; ///< Instruction set.
+
+    /// Compare bytes for equality.
+    bool (*equal)(const char *, const char *, ::std::size_t);
+
+    /// Hash bytes.
+    ::std::size_t (*hash)(::std::string_view);
+};
+
+/**
+ * @brief       Load 8 bytes.
+ *
+ * @param[in]   p           Bytes.
+ *
+ * @return      Word.
+ */
+inline uint64_t load64(const char *p)
+{
+    uint64_t ret;
+    ::memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+/**
+ * @brief       Compare bytes for equality, 8 bytes at a time.
+ *
+ * @param[in]   a           Bytes.
+ * @param[in]   b           Bytes.
+ * @param[in]   size        Size.
+ *
+ * @return      \c true if equal, \c false if not.
+ */
+inline bool equalWords(const char *a, const char *b, ::std::size_t size)
+{
+    ::std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        if (load64(a + i) != load64(b + i)) {
+            return false;
+        }
+    }
+    if (i == size) {
+        return true;
+    } else if (size >= 8) {
+        // Last word overlapping the one compared.
+        return load64(a + size - 8) == load64(b + size - 8);
+    }
+    for (; i < size; ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief       Compare bytes for equality, portable.
+ */
+bool equalScalar(const char *a, const char *b, ::std::size_t size)
+{
+    return equalWords(a, b, size);
+}
+
+/**
+ * @brief       Hash bytes, portable.
+ */
+::std::size_t hashScalar(::std::string_view str)
+{
+    return ::std::hash<::std::string_view> {}(str);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * @brief       Compare bytes for equality, 16 bytes at a time by SSE2.
+ */
+bool equalSse2(const char *a, const char *b, ::std::size_t size)
+{
+    ::std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        auto y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff) {
+            return false;
+        }
+    }
+
+    return equalWords(a + i, b + i, size - i);
+}
+
+/**
+ * @brief       Compare bytes for equality, 32 bytes at a time by AVX2.
+ */
+__attribute__((target("avx2"))) bool
+    equalAvx2(const char *a, const char *b, ::std::size_t size)
+{
+    ::std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1) {
+            return false;
+        }
+    }
+    if (i + 16 <= size) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        auto y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff) {
+            return false;
+        }
+        i += 16;
+    }
+
+    return equalWords(a + i, b + i, size - i);
+}
+
+/**
+ * @brief       Hash bytes by SSE4.2 CRC32C, 8 bytes at a time.
+ */
+__attribute__((target("sse4.2"))) ::std::size_t
+    hashCrc32(::std::string_view str)
+{
+    auto          p    = str.data();
+    auto          size = str.size();
+    uint64_t      crc  = 0xffffffff;
+    ::std::size_t i    = 0;
+    #if defined(__x86_64__)
+    for (; i + 8 <= size; i += 8) {
+        crc = _mm_crc32_u64(crc, load64(p + i));
+    }
+    #endif
+    for (; i < size; ++i) {
+        crc = _mm_crc32_u8(static_cast<uint32_t>(crc),
+                           static_cast<unsigned char>(p[i]));
+    }
+
+    // Spread the 32 bits over the word for power of 2 tables.
+    return static_cast<::std::size_t>((crc ^ size) * 0x9e3779b97f4a7c15ULL);
+}
+
+#elif defined(__aarch64__)
+
+/**
+ * @brief       Compare bytes for equality, 16 bytes at a time by NEON.
+ */
+bool equalNeon(const char *a, const char *b, ::std::size_t size)
+{
+    ::std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto x = vld1q_u8(reinterpret_cast<const uint8_t *>(a + i));
+        auto y = vld1q_u8(reinterpret_cast<const uint8_t *>(b + i));
+        if (vminvq_u8(vceqq_u8(x, y)) != 0xff) {
+            return false;
+        }
+    }
+
+    return equalWords(a + i, b + i, size - i);
+}
+
+#endif
+
+/**
+ * @brief       Get functions of instruction set.
+ *
+ * @param[in]   level       Instruction set.
+ * @param[out]  funcs       Functions.
+ *
+ * @return      \c true if supported, \c false if not.
+ */
+bool functionsOf(SimdLevel level, Functions &funcs)
+{
+    switch (level) {
+        case SimdLevel::SCALAR:
+            funcs = Functions {level, equalScalar, hashScalar};
+            return true;
+
+#if defined(__x86_64__) || defined(__i386__)
+        case SimdLevel::SSE42:
+            if (! __builtin_cpu_supports("sse4.2")) {
+                return false;
+            }
+            funcs = Functions {level, equalSse2, hashCrc32};
+            return true;
+
+        case SimdLevel::AVX2:
+            if (! __builtin_cpu_supports("avx2")
+                || ! __builtin_cpu_supports("sse4.2")) {
+                return false;
+            }
+            funcs = Functions {level, equalAvx2, hashCrc32};
+            return true;
+#elif defined(__aarch64__)
+        case SimdLevel::NEON:
+            funcs = Functions {level, equalNeon, hashScalar};
+            return true;
+#endif
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief       Get functions of the best instruction set supported.
+ *
+ * @return      Functions.
+ */
+Functions detectFunctions()
+{
+    Functions ret;
+    for (auto level : {SimdLevel::AVX2, SimdLevel::SSE42, SimdLevel::NEON}) {
+        if (functionsOf(level, ret)) {
+            return ret;
+        }
+    }
+    functionsOf(SimdLevel::SCALAR, ret);
+
+    return ret;
+}
+
+/// Functions used.
+Functions activeFunctions = detectFunctions();
+
+} // namespace
+
+/**
+ * @brief       Get instruction set used.
+ */
+SimdLevel simdLevel()
+{
+    return activeFunctions.level;
+}
+
+/**
+ * @brief       Use another instruction set.
+ */
+bool setSimdLevel(SimdLevel level)
+{
+    return functionsOf(level, activeFunctions);
+}
+
+/**
+ * @brief       Get name of instruction set.
+ */
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level) {
+        case SimdLevel::SCALAR:
+            return "scalar";
+
+        case SimdLevel::SSE42:
+            return "sse4.2";
+
+        case SimdLevel::AVX2:
+            return "avx2";
+
+        case SimdLevel::NEON:
+            return "neon";
+    }
+
+    return "unknown";
+}
+
+/**
+ * @brief       Compare bytes for equality.
+ */
+bool bytesEqual(const char *a, const char *b, ::std::size_t size)
+{
+    return activeFunctions.equal(a, b, size);
+}
+
+/**
+ * @brief       Hash bytes.
+ */
+::std::size_t hashBytes(::std::string_view str)
+{
+    return activeFunctions.hash(str);
+}
+
+} // namespace findlink
@@ -0,0 +1,763 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <system_error>
+
+#include <dirent.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <findlink/cluster.h>
+#include <findlink/dir_filter.h>
+#include <findlink/dir_scanner.h>
+#include <findlink/link_resolver.h>
+#include <findlink/output_sink.h>
+#include <findlink/target_matcher.h>
+
+namespace findlink {
+
+namespace {
+
+/// Size to receive from a socket at once.
+constexpr ::std::size_t RECV_SIZE = 64 * 1024;
+
+/// Size of record header, type byte and uint32_t size.
+constexpr ::std::size_t RECORD_HEADER_SIZE = 1 + sizeof(uint32_t);
+
+/// Size of shared secret at most.
+constexpr ::std::size_t MAX_SECRET_SIZE = 4096;
+
+/**
+ * @brief       Join directory and name.
+ *
+ * @param[in]   dir         Directory.
+ * @param[in]   name        Name.
+ *
+ * @return      Path.
+ */
+::std::string joinPath(::std::string_view dir, ::std::string_view name)
+{
+    ::std::string ret;
+    ret.reserve(dir.size() + name.size() + 1);
+    ret.append(dir);
+    if (ret.size() > 1 || ret[0] != '/') {
+        ret.push_back('/');
+    }
+    ret.append(name);
+
+    return ret;
+}
+
+/**
+ * @brief       Append request.
+ *
+ * @param[out]  out         Output.
+ * @param[in]   type        Type.
+ * @param[in]   payload     Payload.
+ */
+void appendRequest(::std::string &out, char type, ::std::string_view payload)
+{
+    out.push_back(type);
+    out.append(payload);
+    out.push_back('\0');
+}
+
+/**
+ * @brief       Send whole buffer to socket.
+ *
+ * @param[in]   fd          Socket.
+ * @param[in]   data        Data.
+ *
+ * @return      \c true on success, \c false on failure.
+ */
+bool sendAll(int fd, ::std::string_view data)
+{
+    while (! data.empty()) {
+        auto ret = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<::std::size_t>(ret));
+    }
+
+    return true;
+}
+
+/**
+ * @brief       Compare secrets in time independent of where they differ.
+ *
+ * @param[in]   secret      Secret received.
+ * @param[in]   expected    Secret expected.
+ *
+ * @return      \c true if equal, \c false if not.
+ */
+bool secretEquals(::std::string_view secret, ::std::string_view expected)
+{
+    if (secret.size() != expected.size()) {
+        return false;
+    }
+
+    unsigned char diff = 0;
+    for (::std::size_t i = 0; i < secret.size(); ++i) {
+        diff |= static_cast<unsigned char>(secret[i] ^ expected[i]);
+    }
+
+    return diff == 0;
+}
+
+/**
+ * @brief       Resolve TCP address.
+ *
+ * @param[in]   host        Host, \c nullptr for any address to listen on.
+ * @param[in]   port        Port or service name.
+ * @param[in]   passive     Resolve address to listen on.
+ *
+ * @return      Addresses, freed by \c freeaddrinfo().
+ *
+ * @throw       ::std::system_error
+ */
+::std::unique_ptr<struct addrinfo, void (*)(struct addrinfo *)>
+    resolveAddress(const char *host, const ::std::string &port, bool passive)
+{
+    struct addrinfo hints = {};
+    hints.ai_family       = AF_UNSPEC;
+    hints.ai_socktype     = SOCK_STREAM;
+    hints.ai_flags        = passive ? AI_PASSIVE : 0;
+
+    struct addrinfo *result = nullptr;
+    int ret = ::getaddrinfo(host, port.c_str(), &hints, &result);
+    if (ret != 0) {
+        throw ::std::system_error(
+            ret == EAI_SYSTEM ? errno : EADDRNOTAVAIL,
+            ::std::system_category(),
+            (host == nullptr ? port : ::std::string(host) + ":" + port) + ": "
+                + ::gai_strerror(ret));
+    }
+
+    return {result, ::freeaddrinfo};
+}
+
+/**
+ * @brief       Open TCP socket on the first address that works.
+ *
+ * @param[in]   host        Host to connect to or address to listen on,
+ *                          \c nullptr to listen on any address.
+ * @param[in]   port        Port or service name.
+ * @param[in]   listen      Listen instead of connecting.
+ *
+ * @return      Socket.
+ *
+ * @throw       ::std::system_error
+ */
+int openSocket(const char *host, const ::std::string &port, bool listen)
+{
+    auto addresses = resolveAddress(host, port, listen);
+    int  err       = EADDRNOTAVAIL;
+    for (auto address = addresses.get(); address != nullptr;
+         address      = address->ai_next) {
+        int fd = ::socket(address->ai_family,
+                          address->ai_socktype | SOCK_CLOEXEC,
+                          address->ai_protocol);
+        if (fd < 0) {
+            err = errno;
+            continue;
+        }
+
+        if (! listen) {
+            if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+                return fd;
+            }
+        } else {
+            int on = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            if (::bind(fd, address->ai_addr, address->ai_addrlen) == 0
+                && ::listen(fd, SOMAXCONN) == 0) {
+                return fd;
+            }
+        }
+        err = errno;
+        ::close(fd);
+    }
+
+    throw ::std::system_error(
+        err, ::std::system_category(),
+        host == nullptr ? port : ::std::string(host) + ":" + port);
+}
+
+/**
+ * @brief       Read string of binary record.
+ *
+ * @param[in, out]  data        Data, the string read is removed.
+ * @param[out]      str         String.
+ *
+ * @return      \c true on success, \c false if truncated.
+ */
+bool readString(::std::string_view &data, ::std::string_view &str)
+{
+    uint32_t size;
+    if (data.size() < sizeof(size)) {
+        return false;
+    }
+    ::memcpy(&size, data.data(), sizeof(size));
+    if (data.size() - sizeof(size) < size) {
+        return false;
+    }
+    str = data.substr(sizeof(size), size);
+    data.remove_prefix(sizeof(size) + size);
+
+    return true;
+}
+
+/**
+ * @brief       Read plain value of binary record.
+ *
+ * @param[in, out]  data        Data, the value read is removed.
+ * @param[out]      value       Value.
+ *
+ * @return      \c true on success, \c false if truncated.
+ */
+template<typename T>
+bool readValue(::std::string_view &data, T &value)
+{
+    if (data.size() < sizeof(value)) {
+        return false;
+    }
+    ::memcpy(&value, data.data(), sizeof(value));
+    data.remove_prefix(sizeof(value));
+
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief       Constructor, report links directly in the search directory
+ *              and split its subdirectories into units.
+ */
+ClusterCoordinator::ClusterCoordinator(
+    const Searcher                &searcher,
+    const ::std::filesystem::path &searchDir,
+    const ::std::string           &secret,
+    const LinkFunc                &onLink,
+    const ErrorFunc               &onError) :
+    m_onLink(onLink), m_onError(onError), m_left(0), m_secret(secret),
+    m_dedupLinks(searcher.options().dedupLinks)
+{
+    auto &targets = searcher.targets();
+    auto &options = searcher.options();
+
+    struct stat rootStat;
+    if (::stat(searchDir.c_str(), &rootStat) < 0) {
+        throw ::std::filesystem::filesystem_error(
+            "cannot stat", searchDir,
+            ::std::error_code(errno, ::std::system_category()));
+    }
+
+    // Requests sent to each worker at connect, devices are compared with
+    // the search directory instead of the unit.
+    for (auto &target : targets) {
+        appendRequest(m_hello, 'T', target);
+    }
+    for (auto &glob : options.targetGlobs) {
+        appendRequest(m_hello, 'G', glob);
+    }
+    for (auto &pattern : options.excludes) {
+        appendRequest(m_hello, 'X', pattern);
+    }
+    for (auto &type : options.excludeFsTypes) {
+        appendRequest(m_hello, 'F', type);
+    }
+    appendRequest(m_hello, 'R', ::std::to_string(rootStat.st_dev));
+    for (auto dev : options.targetDevs) {
+        appendRequest(m_hello, 'P', ::std::to_string(dev));
+    }
+    if (options.oneFileSystem) {
+        appendRequest(m_hello, 'O', {});
+    }
+    if (options.under) {
+        appendRequest(m_hello, 'U', {});
+    }
+    if (options.visitOnce) {
+        appendRequest(m_hello, 'V', {});
+    }
+    if (m_dedupLinks) {
+        appendRequest(m_hello, 'K', {});
+    }
+
+    // Subdirectories skipped.
+    DirFilter filter;
+    for (auto &pattern : options.excludes) {
+        filter.addExclude(pattern);
+    }
+    for (auto &type : options.excludeFsTypes) {
+        filter.addFsType(type);
+    }
+    filter.addMounts(searchDir.native(), rootStat.st_dev,
+                     options.oneFileSystem, options.targetDevs);
+    bool checkChildren = filter.checkChildren(searchDir.native());
+
+    // Links of the search directory here, subdirectories are units.
+    GlobMatcher       matcher(targets, options.targetGlobs, options.under);
+    LinkResolver      resolver(targets, options.stats);
+    DirScanner        scanner(searchDir.native());
+    DirScanner::Entry entry;
+    auto             &dir = scanner.path();
+    while (scanner.next(entry)) {
+        try {
+            auto type = scanner.type(entry);
+            if (type == DT_LNK) {
+                auto raw      = scanner.readLink(entry);
+                auto linkedTo = resolver.resolve(dir, entry.name, raw);
+                auto matched  = matcher(linkedTo);
+                if (matched
+                    && (! m_dedupLinks
+                        || m_links.visit(rootStat.st_dev, entry.ino,
+                                         linkedTo))) {
+                    m_onLink(RecordWriter::Link {
+                        joinPath(dir, entry.name), raw, linkedTo, *matched,
+                        static_cast<uint64_t>(rootStat.st_dev), entry.ino});
+                }
+            } else if (type == DT_DIR
+                       && (! checkChildren
+                           || ! filter.excluded(dir, entry.name))) {
+                m_units.push_back(
+                    Unit {joinPath(dir, entry.name), 0, false, {}});
+                m_pending.push_back(m_units.size() - 1);
+            }
+        } catch (::std::filesystem::filesystem_error &e) {
+            m_onError(e.path1().native(), e.code().value(), e.what());
+        }
+    }
+    m_left = m_units.size();
+}
+
+/**
+ * @brief       Listen on a TCP port and hand units to workers until all are
+ *              done.
+ */
+void ClusterCoordinator::run(const ::std::string &address,
+                             const ::std::string &port)
+{
+    if (m_left == 0) {
+        return;
+    }
+
+    int  listenFd = openSocket(address.empty() ? nullptr : address.c_str(),
+                               port, true);
+    auto cleanup  = [&]() -> void {
+        for (auto &[fd, worker] : m_workers) {
+            ::close(fd);
+        }
+        m_workers.clear();
+        ::close(listenFd);
+    };
+
+    try {
+        ::std::vector<struct pollfd> fds;
+        while (m_left > 0) {
+            fds.clear();
+            fds.push_back({listenFd, POLLIN, 0});
+            for (auto &[fd, worker] : m_workers) {
+                fds.push_back({fd, POLLIN, 0});
+            }
+            if (::poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw ::std::system_error(errno, ::std::system_category(),
+                                          "poll");
+            }
+
+            // New worker.
+            if (fds[0].revents != 0) {
+                int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd >= 0) {
+                    m_workers.emplace(fd, Worker {{}, {}, NO_UNIT, false});
+                }
+            }
+
+            // Results.
+            for (::std::size_t i = 1; i < fds.size(); ++i) {
+                if (fds[i].revents == 0) {
+                    continue;
+                }
+                auto &worker = m_workers[fds[i].fd];
+                char  data[RECV_SIZE];
+                auto  size = ::recv(fds[i].fd, data, sizeof(data), 0);
+                if (size <= 0) {
+                    if (size == 0 || errno != EINTR) {
+                        this->drop(fds[i].fd);
+                    }
+                    continue;
+                }
+                worker.received.append(data, static_cast<::std::size_t>(size));
+                if (! worker.authenticated
+                    && ! this->authenticate(fds[i].fd, worker)) {
+                    this->drop(fds[i].fd);
+                } else if (worker.authenticated) {
+                    this->parse(worker);
+                }
+            }
+
+            // Units queued again and copies go to idle workers.
+            for (auto iter = m_workers.begin(); iter != m_workers.end();) {
+                auto fd = iter->first;
+                ++iter;
+                auto &worker = m_workers[fd];
+                if (worker.authenticated && worker.unit == NO_UNIT
+                    && m_left > 0 && ! this->assign(fd, worker)) {
+                    this->drop(fd);
+                }
+            }
+        }
+    } catch (...) {
+        cleanup();
+        throw;
+    }
+
+    cleanup();
+}
+
+/**
+ * @brief       Check the secret a worker sends first, then send it the
+ *              targets and options.
+ */
+bool ClusterCoordinator::authenticate(int fd, Worker &worker)
+{
+    auto &data = worker.received;
+    if (data.empty()) {
+        return true;
+    } else if (data[0] != 'A') {
+        return false;
+    } else if (data.size() < RECORD_HEADER_SIZE) {
+        return true;
+    }
+
+    uint32_t size;
+    ::memcpy(&size, data.data() + 1, sizeof(size));
+    if (size > MAX_SECRET_SIZE) {
+        return false;
+    } else if (data.size() - RECORD_HEADER_SIZE < size) {
+        return true;
+    }
+
+    bool matched = secretEquals(
+        ::std::string_view(data).substr(RECORD_HEADER_SIZE, size), m_secret);
+    data.erase(0, RECORD_HEADER_SIZE + size);
+    if (! matched) {
+        return false;
+    }
+    worker.authenticated = true;
+
+    return sendAll(fd, m_hello);
+}
+
+/**
+ * @brief       Give a unit to an idle worker.
+ */
+bool ClusterCoordinator::assign(int fd, Worker &worker)
+{
+    // Units never started first, then a copy of the one running longest.
+    auto unit = NO_UNIT;
+    if (! m_pending.empty()) {
+        unit = m_pending.front();
+        m_pending.pop_front();
+    } else {
+        for (::std::size_t i = 0; i < m_units.size(); ++i) {
+            auto &candidate = m_units[i];
+            if (candidate.done || candidate.running == 0
+                || candidate.running >= MAX_COPIES) {
+                continue;
+            }
+            if (unit == NO_UNIT || candidate.started < m_units[unit].started) {
+                unit = i;
+            }
+        }
+        if (unit == NO_UNIT) {
+            return true;
+        }
+    }
+
+    auto &target = m_units[unit];
+    if (target.running++ == 0) {
+        target.started = Clock::now();
+    }
+    worker.unit = unit;
+    worker.records.clear();
+
+    ::std::string request;
+    appendRequest(request, 'S', target.dir);
+    return sendAll(fd, request);
+}
+
+/**
+ * @brief       Parse records received from a worker.
+ */
+void ClusterCoordinator::parse(Worker &worker)
+{
+    auto         &data  = worker.received;
+    ::std::size_t begin = 0;
+    while (data.size() - begin >= RECORD_HEADER_SIZE) {
+        uint32_t size;
+        ::memcpy(&size, data.data() + begin + 1, sizeof(size));
+        if (data.size() - begin - RECORD_HEADER_SIZE < size) {
+            break;
+        }
+
+        // Records of a copy already reported are dropped at its end.
+        if (worker.unit != NO_UNIT) {
+            if (data[begin] == 'D') {
+                auto &unit = m_units[worker.unit];
+                --unit.running;
+                if (! unit.done) {
+                    unit.done = true;
+                    --m_left;
+                    this->report(worker.records);
+                }
+                worker.records.clear();
+                worker.unit = NO_UNIT;
+            } else {
+                worker.records.append(data, begin, RECORD_HEADER_SIZE + size);
+            }
+        }
+        begin += RECORD_HEADER_SIZE + size;
+    }
+    data.erase(0, begin);
+}
+
+/**
+ * @brief       Report records of a unit.
+ */
+void ClusterCoordinator::report(::std::string_view records)
+{
+    while (records.size() >= RECORD_HEADER_SIZE) {
+        char     type = records[0];
+        uint32_t size;
+        ::memcpy(&size, records.data() + 1, sizeof(size));
+        auto record = records.substr(RECORD_HEADER_SIZE, size);
+        records.remove_prefix(RECORD_HEADER_SIZE + record.size());
+
+        if (type == 'L') {
+            RecordWriter::Link link;
+            if (readString(record, link.path) && readString(record, link.raw)
+                && readString(record, link.target)
+                && readString(record, link.matched)
+                && readValue(record, link.dev) && readValue(record, link.ino)
+                && (! m_dedupLinks
+                    || m_links.visit(link.dev, link.ino, link.target))) {
+                m_onLink(link);
+            }
+        } else if (type == 'E') {
+            ::std::string_view path;
+            int32_t            err;
+            ::std::string_view message;
+            if (readString(record, path) && readValue(record, err)
+                && readString(record, message)) {
+                m_onError(path, err, message);
+            }
+        }
+    }
+}
+
+/**
+ * @brief       Drop a worker, its unit is queued again if no other copy
+ *              runs.
+ */
+void ClusterCoordinator::drop(int fd)
+{
+    auto iter = m_workers.find(fd);
+    if (iter == m_workers.end()) {
+        return;
+    }
+
+    auto unit = iter->second.unit;
+    if (unit != NO_UNIT && --m_units[unit].running == 0
+        && ! m_units[unit].done) {
+        m_pending.push_front(unit);
+    }
+    ::close(fd);
+    m_workers.erase(iter);
+}
+
+/**
+ * @brief       Constructor.
+ */
+ClusterWorker::ClusterWorker(SearchOptions options, ::std::string secret) :
+    m_options(::std::move(options)), m_secret(::std::move(secret))
+{}
+
+/**
+ * @brief       Connect to the coordinator and search units until it closes
+ *              the connection.
+ */
+::std::size_t ClusterWorker::run(const ::std::string &host,
+                                 const ::std::string &port)
+{
+    int  fd      = openSocket(host.c_str(), port, false);
+    auto options = m_options;
+
+    // Secret record first.
+    ::std::string hello(RECORD_HEADER_SIZE, 'A');
+    auto          secretSize = static_cast<uint32_t>(m_secret.size());
+    ::memcpy(hello.data() + 1, &secretSize, sizeof(secretSize));
+    hello.append(m_secret);
+    if (! sendAll(fd, hello)) {
+        int err = errno;
+        ::close(fd);
+        throw ::std::system_error(err, ::std::system_category(), "send");
+    }
+
+    TargetSet                   targets;
+    ::std::unique_ptr<Searcher> searcher;
+    ::std::string               buffer;
+    ::std::size_t               ret     = 0;
+    bool                        closed  = false;
+    bool                        greeted = false;
+    try {
+        while (true) {
+            // Requests.
+            ::std::size_t begin = 0;
+            while (! closed) {
+                auto end = buffer.find('\0', begin);
+                if (end == ::std::string::npos) {
+                    break;
+                }
+                ::std::string payload(buffer, begin + 1, end - begin - 1);
+                auto          type = buffer[begin];
+                begin              = end + 1;
+
+                switch (type) {
+                    case 'T':
+                        targets.add(payload);
+                        break;
+
+                    case 'G':
+                        options.targetGlobs.push_back(::std::move(payload));
+                        break;
+
+                    case 'X':
+                        options.excludes.push_back(::std::move(payload));
+                        break;
+
+                    case 'F':
+                        options.excludeFsTypes.push_back(::std::move(payload));
+                        break;
+
+                    case 'R':
+                        options.rootDev = static_cast<dev_t>(
+                            ::strtoull(payload.c_str(), nullptr, 10));
+                        break;
+
+                    case 'P':
+                        options.targetDevs.push_back(static_cast<dev_t>(
+                            ::strtoull(payload.c_str(), nullptr, 10)));
+                        break;
+
+                    case 'O':
+                        options.oneFileSystem = true;
+                        break;
+
+                    case 'U':
+                        options.under = true;
+                        break;
+
+                    case 'V':
+                        options.visitOnce = true;
+                        break;
+
+                    case 'K':
+                        options.dedupLinks = true;
+                        break;
+
+                    case 'S': {
+                        // Targets and options come before the first unit.
+                        if (! searcher) {
+                            searcher = ::std::make_unique<Searcher>(
+                                ::std::move(targets), options);
+                        }
+
+                        OutputSink   output(fd, '\n');
+                        RecordWriter writer(
+                            output, RecordWriter::Format::BINARY, false);
+                        try {
+                            searcher->search(
+                                payload,
+                                [&](const Searcher::Link &link) -> bool {
+                                    writer.writeLink(RecordWriter::Link {
+                                        link.path(), link.raw, link.linkedTo,
+                                        link.matched, link.dev, link.ino});
+                                    return ! output.failed();
+                                },
+                                [&](const ::std::filesystem::filesystem_error
+                                        &e) -> void { writer.writeError(e); });
+                        } catch (::std::filesystem::filesystem_error &e) {
+                            writer.writeError(e);
+                        }
+                        output.flush();
+
+                        // Done record.
+                        char done[RECORD_HEADER_SIZE] = {'D'};
+                        int  err                      = output.error();
+                        if (err == 0
+                            && ! sendAll(fd, ::std::string_view(
+                                                 done, sizeof(done)))) {
+                            err = errno;
+                        }
+
+                        // The coordinator closes the connection once every
+                        // unit is done, a copy of this one may have won.
+                        if (err == EPIPE || err == ECONNRESET) {
+                            closed = true;
+                        } else if (err != 0) {
+                            throw ::std::system_error(
+                                err, ::std::system_category(), "send");
+                        } else {
+                            ++ret;
+                        }
+                    } break;
+
+                    default:
+                        throw ::std::system_error(
+                            EPROTO, ::std::system_category(), host);
+                }
+            }
+            buffer.erase(0, begin);
+            if (closed) {
+                break;
+            }
+
+            char data[RECV_SIZE];
+            auto size = ::recv(fd, data, sizeof(data), 0);
+            if (size < 0 && errno == EINTR) {
+                continue;
+            } else if (size < 0 && errno != ECONNRESET) {
+                throw ::std::system_error(errno, ::std::system_category(),
+                                          "recv");
+            } else if (size <= 0 && ! greeted) {
+                // Workers sending a wrong secret are dropped at once.
+                throw ::std::system_error(
+                    EACCES, ::std::system_category(),
+                    host + ": closed before sending targets, wrong secret");
+            } else if (size <= 0) {
+                break;
+            }
+            greeted = true;
+            buffer.append(data, static_cast<::std::size_t>(size));
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+
+    return ret;
+}
+
+} // namespace findlink
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <sched.h>
+
+#include <findlink/cpu_count.h>
+
+namespace findlink {
+
+namespace {
+
+/**
+ * @brief       Parse quota to CPU count.
+ *
+ * @param[in]   quota       Quota, negative if unlimited.
+ * @param[in]   period      Period.
+ *
+ * @return      CPU count, 0 if unlimited.
+ */
+unsigned int quotaToCount(long long quota, long long period)
+{
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+
+    return static_cast<unsigned int>(::std::max(
+        1.0, ::std::ceil(static_cast<double>(quota)
+                         / static_cast<double>(period))));
+}
+
+/**
+ * @brief       Read cgroup v2 quota, the smallest limit of the cgroup and its
+ *              ancestors is used.
+ *
+ * @param[in]   cgroup      Cgroup path.
+ *
+ * @return      CPU count, 0 if unlimited.
+ */
+unsigned int cgroupV2Count(::std::string cgroup)
+{
+    unsigned int ret = 0;
+    while (true) {
+        ::std::ifstream file("/sys/fs/cgroup" + cgroup + "/cpu.max");
+        ::std::string   quota;
+        long long       period = 0;
+        if (file >> quota >> period && quota != "max") {
+            auto count = quotaToCount(::std::stoll(quota), period);
+            if (count > 0 && (ret == 0 || count < ret)) {
+                ret = count;
+            }
+        }
+
+        if (cgroup.empty() || cgroup == "/") {
+            return ret;
+        }
+        cgroup.resize(cgroup.rfind('/'));
+    }
+}
+
+/**
+ * @brief       Read cgroup v1 quota.
+ *
+ * @param[in]   cgroup      Cgroup path.
+ *
+ * @return      CPU count, 0 if unlimited.
+ */
+unsigned int cgroupV1Count(const ::std::string &cgroup)
+{
+    for (auto &mount : {"/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu"}) {
+        for (auto &dir : {::std::string(mount) + cgroup, ::std::string(mount)}) {
+            ::std::ifstream quotaFile(dir + "/cpu.cfs_quota_us");
+            ::std::ifstream periodFile(dir + "/cpu.cfs_period_us");
+            long long       quota  = 0;
+            long long       period = 0;
+            if (quotaFile >> quota && periodFile >> period) {
+                return quotaToCount(quota, period);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       Get cgroup CPU quota.
+ *
+ * @return      CPU count, 0 if unlimited.
+ */
+unsigned int cgroupCount()
+{
+    ::std::ifstream file("/proc/self/cgroup");
+    ::std::string   line;
+    while (::std::getline(file, line)) {
+        // hierarchy-ID:controller-list:cgroup-path
+        auto first  = line.find(':');
+        auto second = line.find(':', first + 1);
+        if (first == ::std::string::npos || second == ::std::string::npos) {
+            continue;
+        }
+        auto controllers = line.substr(first + 1, second - first - 1);
+        auto cgroup      = line.substr(second + 1);
+        if (cgroup == "/") {
+            cgroup.clear();
+        }
+
+        if (controllers.empty()) {
+            auto count = cgroupV2Count(cgroup);
+            if (count > 0) {
+                return count;
+            }
+        } else {
+            ::std::stringstream stream(controllers);
+            ::std::string       controller;
+            while (::std::getline(stream, controller, ',')) {
+                if (controller == "cpu") {
+                    return cgroupV1Count(cgroup);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+/**
+ * @brief       Get number of CPUs this process may use.
+ */
+unsigned int availableCpuCount()
+{
+    unsigned int ret = ::std::thread::hardware_concurrency();
+
+    // Affinity.
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        auto count = static_cast<unsigned int>(CPU_COUNT(&set));
+        if (count > 0 && (ret == 0 || count < ret)) {
+            ret = count;
+        }
+    }
+
+    // Cgroup quota.
+    auto count = cgroupCount();
+    if (count > 0 && (ret == 0 || count < ret)) {
+        ret = count;
+    }
+
+    return ::std::max(ret, 1u);
+}
+
+} // namespace findlink
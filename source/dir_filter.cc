@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <fnmatch.h>
+#include <sys/sysmacros.h>
+
+#include <findlink/dir_filter.h>
+
+namespace findlink {
+
+namespace {
+
+/// Pseudo filesystems never holding links worth searching.
+const char *const PSEUDO_FS_TYPES[] = {
+    "proc",    "sysfs",  "cgroup",   "cgroup2",   "debugfs",
+    "tracefs", "bpf",    "pstore",   "configfs",  "securityfs",
+    "fusectl", "mqueue", "efivarfs", "hugetlbfs", "binfmt_misc",
+};
+
+/**
+ * @brief       Check if filesystem type is a pseudo filesystem.
+ *
+ * @param[in]   type        Filesystem type.
+ *
+ * @return      \c true if pseudo, \c false if not.
+ */
+bool isPseudoFs(const ::std::string &type)
+{
+    for (auto pseudo : PSEUDO_FS_TYPES) {
+        if (type == pseudo) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief       Check if character is an octal digit.
+ *
+ * @param[in]   c           Character.
+ *
+ * @return      \c true if octal digit, \c false if not.
+ */
+inline bool isOctal(char c)
+{
+    return c >= '0' && c <= '7';
+}
+
+/**
+ * @brief       Unescape octal escapes of mountinfo field.
+ *
+ * @param[in]   field       Field.
+ *
+ * @return      Unescaped field.
+ */
+::std::string unescape(const ::std::string &field)
+{
+    ::std::string ret;
+    for (::std::size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size() && isOctal(field[i + 1])
+            && isOctal(field[i + 2]) && isOctal(field[i + 3])) {
+            ret.push_back(static_cast<char>((field[i + 1] - '0') * 64
+                                            + (field[i + 2] - '0') * 8
+                                            + (field[i + 3] - '0')));
+            i += 3;
+        } else {
+            ret.push_back(field[i]);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Join directory and name.
+ *
+ * @param[in]   dir         Directory.
+ * @param[in]   name        Name.
+ *
+ * @return      Path.
+ */
+::std::string joinPath(const ::std::string &dir, ::std::string_view name)
+{
+    ::std::string ret(dir);
+    if (ret.size() > 1 || ret[0] != '/') {
+        ret.push_back('/');
+    }
+    ret.append(name);
+
+    return ret;
+}
+
+} // namespace
+
+/**
+ * @brief       Add exclude pattern.
+ */
+void DirFilter::addExclude(const ::std::string &pattern)
+{
+    if (pattern.find_first_of("*?[") == ::std::string::npos) {
+        auto path = ::std::filesystem::absolute(pattern).lexically_normal();
+        auto str  = path.native();
+        while (str.size() > 1 && str.back() == '/') {
+            str.pop_back();
+        }
+        this->addPath(::std::move(str));
+    } else if (pattern.find('/') != ::std::string::npos) {
+        m_pathGlobs.push_back(pattern);
+    } else {
+        m_nameGlobs.push_back(pattern);
+    }
+}
+
+/**
+ * @brief       Skip mount points of a filesystem type, must be called before
+ *              \c addMounts().
+ */
+void DirFilter::addFsType(const ::std::string &type)
+{
+    m_fsTypes.push_back(type);
+}
+
+/**
+ * @brief       Skip mount points of pseudo filesystems and of types added,
+ *              and of other filesystems if \c oneFileSystem is set or
+ *              \c devs is not empty.
+ */
+void DirFilter::addMounts(const ::std::string        &root,
+                          dev_t                       rootDev,
+                          bool                        oneFileSystem,
+                          const ::std::vector<dev_t> &devs)
+{
+    ::std::ifstream stream("/proc/self/mountinfo");
+    ::std::string   line;
+    while (::std::getline(stream, line)) {
+        // ID PARENT MAJOR:MINOR ROOT MOUNT_POINT OPTIONS [OPTIONAL...] - TYPE
+        ::std::istringstream fields(line);
+        ::std::string        id, parent, dev, mountRoot, mountPoint, field;
+        fields >> id >> parent >> dev >> mountRoot >> mountPoint;
+        while (fields >> field && field != "-") {
+        }
+        ::std::string type;
+        fields >> type;
+
+        unsigned int major = 0;
+        unsigned int minor = 0;
+        if (type.empty()
+            || ::sscanf(dev.c_str(), "%u:%u", &major, &minor) != 2) {
+            continue;
+        }
+
+        // Mount points under search directory only.
+        mountPoint = unescape(mountPoint);
+        if (mountPoint == root
+            || mountPoint.compare(0, root.size(), root) != 0
+            || (root.size() > 1 && mountPoint[root.size()] != '/')) {
+            continue;
+        }
+
+        auto mountDev = ::makedev(major, minor);
+        if (isPseudoFs(type)
+            || ::std::find(m_fsTypes.begin(), m_fsTypes.end(), type)
+                   != m_fsTypes.end()
+            || (oneFileSystem && mountDev != rootDev)
+            || (! devs.empty() && mountDev != rootDev
+                && ::std::find(devs.begin(), devs.end(), mountDev)
+                       == devs.end())) {
+            this->addPath(::std::move(mountPoint));
+        }
+    }
+}
+
+/**
+ * @brief       Check if subdirectory is excluded.
+ */
+bool DirFilter::excluded(const ::std::string &dir,
+                         ::std::string_view   name) const
+{
+    if (! m_nameGlobs.empty()) {
+        // Names may be views into a larger buffer, fnmatch() needs NUL.
+        thread_local ::std::string nameBuffer;
+        nameBuffer.assign(name);
+        for (auto &glob : m_nameGlobs) {
+            if (::fnmatch(glob.c_str(), nameBuffer.c_str(), 0) == 0) {
+                return true;
+            }
+        }
+    }
+
+    if (m_pathGlobs.empty() && m_parents.find(dir) == m_parents.end()) {
+        return false;
+    }
+    auto path = joinPath(dir, name);
+    if (m_paths.find(path) != m_paths.end()) {
+        return true;
+    }
+    for (auto &glob : m_pathGlobs) {
+        if (::fnmatch(glob.c_str(), path.c_str(), 0) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief       Add path skipped.
+ */
+void DirFilter::addPath(::std::string path)
+{
+    auto pos = path.rfind('/');
+    if (pos != ::std::string::npos) {
+        m_parents.emplace(path.substr(0, pos == 0 ? 1 : pos));
+    }
+    m_paths.emplace(::std::move(path));
+}
+
+} // namespace findlink
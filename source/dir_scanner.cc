@@ -0,0 +1,190 @@
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <system_error>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <findlink/dir_scanner.h>
+
+namespace findlink {
+
+/**
+ * @brief       Constructor, open directory.
+ */
+DirScanner::DirScanner(const ::std::string &path) :
+    m_path(path), m_fd(-1), m_offset(0), m_size(0)
+{
+    m_fd = ::open(path.c_str(),
+                  O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (m_fd < 0) {
+        this->throwError("cannot open directory");
+    }
+}
+
+/**
+ * @brief       Constructor, take an opened directory fd.
+ */
+DirScanner::DirScanner(int fd, const ::std::string &path) :
+    m_path(path), m_fd(fd), m_offset(0), m_size(0)
+{}
+
+/**
+ * @brief       Destructor, close directory.
+ */
+DirScanner::~DirScanner()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+/**
+ * @brief       Read next entry, "." and ".." are skipped.
+ */
+bool DirScanner::next(Entry &entry)
+{
+    while (! this->nextInBatch(entry)) {
+        if (! this->nextBatch()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief       Read next batch of entries.
+ */
+bool DirScanner::nextBatch()
+{
+    ssize_t size = ::getdents64(m_fd, m_buffer, BUFFER_SIZE);
+    if (size < 0) {
+        this->throwError("cannot read directory");
+    }
+    m_offset = 0;
+    m_size   = static_cast<::std::size_t>(size);
+
+    return size > 0;
+}
+
+/**
+ * @brief       Read next entry of current batch, "." and ".." are skipped.
+ */
+bool DirScanner::nextInBatch(Entry &entry)
+{
+    while (m_offset < m_size) {
+        auto record = reinterpret_cast<struct dirent64 *>(m_buffer + m_offset);
+        m_offset += record->d_reclen;
+
+        const char *name = record->d_name;
+        if (name[0] == '.'
+            && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+
+        entry.name = ::std::string_view(name);
+        entry.ino  = record->d_ino;
+        entry.type = record->d_type;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief       Get offset of directory after current batch.
+ */
+off_t DirScanner::batchEnd() const
+{
+    // Offset of the last record is where the next getdents64 starts.
+    off_t         ret    = 0;
+    ::std::size_t offset = 0;
+    while (offset < m_size) {
+        auto record = reinterpret_cast<const struct dirent64 *>(m_buffer
+                                                                + offset);
+        ret = record->d_off;
+        offset += record->d_reclen;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Seek directory, current batch is dropped.
+ */
+void DirScanner::seek(off_t offset)
+{
+    if (::lseek(m_fd, offset, SEEK_SET) < 0) {
+        this->throwError("cannot seek directory");
+    }
+    m_offset = 0;
+    m_size   = 0;
+}
+
+/**
+ * @brief       Get entry type, stat the entry if the filesystem does not
+ *              report d_type.
+ */
+uint8_t DirScanner::type(Entry &entry) const
+{
+    if (entry.type == DT_UNKNOWN) {
+        struct stat st;
+        if (::fstatat(m_fd, entry.name.data(), &st, AT_SYMLINK_NOFOLLOW)
+            < 0) {
+            this->throwError("cannot stat", entry.name);
+        }
+        entry.type = IFTODT(st.st_mode);
+    }
+
+    return entry.type;
+}
+
+/**
+ * @brief       Read link target relative to the directory fd.
+ */
+::std::string DirScanner::readLink(const Entry &entry) const
+{
+    char    buffer[PATH_MAX];
+    ssize_t size = ::readlinkat(m_fd, entry.name.data(), buffer, PATH_MAX);
+    if (size < 0) {
+        this->throwError("cannot read link", entry.name);
+    }
+
+    if (static_cast<::std::size_t>(size) < PATH_MAX) {
+        return ::std::string(buffer, static_cast<::std::size_t>(size));
+    }
+
+    // Link target does not fit in PATH_MAX, grow buffer.
+    ::std::string ret(PATH_MAX * 2, '\0');
+    while (true) {
+        size = ::readlinkat(m_fd, entry.name.data(), ret.data(), ret.size());
+        if (size < 0) {
+            this->throwError("cannot read link", entry.name);
+        } else if (static_cast<::std::size_t>(size) < ret.size()) {
+            ret.resize(static_cast<::std::size_t>(size));
+            return ret;
+        }
+        ret.resize(ret.size() * 2);
+    }
+}
+
+/**
+ * @brief       Throw filesystem error of current errno.
+ */
+void DirScanner::throwError(const char *what, ::std::string_view name) const
+{
+    ::std::error_code ec(errno, ::std::system_category());
+    if (name.empty()) {
+        throw ::std::filesystem::filesystem_error(
+            what, ::std::filesystem::path(m_path), ec);
+    } else {
+        throw ::std::filesystem::filesystem_error(
+            what, ::std::filesystem::path(m_path) / name, ec);
+    }
+}
+
+} // namespace findlink
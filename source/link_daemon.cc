@@ -0,0 +1,680 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <findlink/dir_scanner.h>
+#include <findlink/link_daemon.h>
+
+namespace findlink {
+
+namespace {
+
+/// Events watched on each directory.
+constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM
+                                | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW
+                                | IN_EXCL_UNLINK;
+
+/// Size to receive from a socket at once.
+constexpr ::std::size_t RECV_SIZE = 4096;
+
+/// Send timeout of a client, a client not reading is dropped.
+constexpr time_t SEND_TIMEOUT_SECONDS = 1;
+
+/**
+ * @brief       Join directory and name.
+ *
+ * @param[in]   dir         Directory.
+ * @param[in]   name        Name.
+ *
+ * @return      Path.
+ */
+::std::string joinPath(::std::string_view dir, ::std::string_view name)
+{
+    ::std::string ret;
+    ret.reserve(dir.size() + name.size() + 1);
+    ret.append(dir);
+    if (ret.size() > 1 || ret[0] != '/') {
+        ret.push_back('/');
+    }
+    ret.append(name);
+
+    return ret;
+}
+
+/**
+ * @brief       Make address of Unix socket.
+ *
+ * @param[in]   path        Path of socket.
+ *
+ * @return      Address.
+ *
+ * @throw       ::std::system_error
+ */
+struct sockaddr_un socketAddress(const ::std::filesystem::path &path)
+{
+    struct sockaddr_un ret = {};
+    ret.sun_family         = AF_UNIX;
+    if (path.native().size() >= sizeof(ret.sun_path)) {
+        throw ::std::system_error(ENAMETOOLONG, ::std::system_category(),
+                                  path.native());
+    }
+    ::strcpy(ret.sun_path, path.c_str());
+
+    return ret;
+}
+
+/**
+ * @brief       Send whole buffer to socket.
+ *
+ * @param[in]   fd          Socket.
+ * @param[in]   data        Data.
+ *
+ * @return      \c true on success, \c false on failure.
+ */
+bool sendAll(int fd, ::std::string_view data)
+{
+    while (! data.empty()) {
+        auto ret = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<::std::size_t>(ret));
+    }
+
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief       Constructor, traverse the directory.
+ */
+LinkDaemon::LinkDaemon(const ::std::filesystem::path &root,
+                       const SearchOptions           &options,
+                       const Searcher::ErrorFunc     &onError) :
+    m_root(root), m_searcher({}, options), m_onError(onError), m_rootDev(0),
+    m_inotifyFd(-1)
+{
+    struct stat st;
+    if (::stat(m_root.c_str(), &st) < 0) {
+        throw ::std::system_error(errno, ::std::system_category(),
+                                  m_root.native());
+    }
+    m_rootDev = st.st_dev;
+    for (auto &pattern : options.excludes) {
+        m_filter.addExclude(pattern);
+    }
+    for (auto &type : options.excludeFsTypes) {
+        m_filter.addFsType(type);
+    }
+    m_filter.addMounts(m_root.native(), st.st_dev, options.oneFileSystem,
+                       options.targetDevs);
+
+    this->reload();
+}
+
+/**
+ * @brief       Destructor.
+ */
+LinkDaemon::~LinkDaemon()
+{
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+}
+
+/**
+ * @brief       Serve queries until SIGINT or SIGTERM.
+ */
+void LinkDaemon::serve(const ::std::filesystem::path &socketPath)
+{
+    auto address = socketAddress(socketPath);
+
+    // Signals, threads of later traversals inherit the mask.
+    sigset_t signals;
+    sigset_t oldSignals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &signals, &oldSignals);
+    int signalFd = ::signalfd(-1, &signals, SFD_CLOEXEC);
+    if (signalFd < 0) {
+        int err = errno;
+        ::pthread_sigmask(SIG_SETMASK, &oldSignals, nullptr);
+        throw ::std::system_error(err, ::std::system_category(), "signalfd");
+    }
+
+    // Listen, a socket left by a daemon killed is replaced.
+    ::std::unordered_map<int, ::std::string> clients;
+    int                                      listenFd = -1;
+    bool                                     bound    = false;
+
+    auto cleanup = [&]() -> void {
+        for (auto &[fd, buffer] : clients) {
+            ::close(fd);
+        }
+        if (listenFd >= 0) {
+            ::close(listenFd);
+        }
+        if (bound) {
+            ::unlink(socketPath.c_str());
+        }
+        ::close(signalFd);
+        ::pthread_sigmask(SIG_SETMASK, &oldSignals, nullptr);
+    };
+    auto fail = [&](const char *what) -> void {
+        int err = errno;
+        cleanup();
+        throw ::std::system_error(err, ::std::system_category(), what);
+    };
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        fail("socket");
+    }
+    struct stat st;
+    if (::lstat(socketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        ::unlink(socketPath.c_str());
+    }
+    if (::bind(listenFd, reinterpret_cast<struct sockaddr *>(&address),
+               sizeof(address))
+        < 0) {
+        fail(socketPath.c_str());
+    }
+    bound = true;
+    if (::listen(listenFd, SOMAXCONN) < 0) {
+        fail(socketPath.c_str());
+    }
+
+    try {
+        ::std::vector<struct pollfd> fds;
+        while (true) {
+            fds.clear();
+            fds.push_back({signalFd, POLLIN, 0});
+            fds.push_back({m_inotifyFd, POLLIN, 0});
+            fds.push_back({listenFd, POLLIN, 0});
+            for (auto &[fd, buffer] : clients) {
+                fds.push_back({fd, POLLIN, 0});
+            }
+            if (::poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw ::std::system_error(errno, ::std::system_category(),
+                                          "poll");
+            }
+
+            // Stop, the signal is consumed so it is not raised again when
+            // unblocked.
+            if (fds[0].revents != 0) {
+                struct signalfd_siginfo info;
+                [[maybe_unused]] auto   size
+                    = ::read(signalFd, &info, sizeof(info));
+                break;
+            }
+
+            // Apply changes before answering.
+            if (fds[1].revents != 0) {
+                this->handleEvents();
+            }
+
+            // New client.
+            if (fds[2].revents != 0) {
+                int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd >= 0) {
+                    struct timeval timeout = {SEND_TIMEOUT_SECONDS, 0};
+                    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                                 sizeof(timeout));
+                    clients.emplace(fd, ::std::string());
+                }
+            }
+
+            // Requests.
+            for (::std::size_t i = 3; i < fds.size(); ++i) {
+                if (fds[i].revents == 0) {
+                    continue;
+                }
+                auto &buffer = clients[fds[i].fd];
+                char  data[RECV_SIZE];
+                auto  size = ::recv(fds[i].fd, data, sizeof(data), 0);
+                if (size > 0) {
+                    buffer.append(data, static_cast<::std::size_t>(size));
+                }
+                if (size <= 0 || ! this->handleRequests(fds[i].fd, buffer)
+                    || buffer.size() > MAX_REQUEST_SIZE) {
+                    ::close(fds[i].fd);
+                    clients.erase(fds[i].fd);
+                }
+            }
+        }
+    } catch (...) {
+        cleanup();
+        throw;
+    }
+
+    cleanup();
+}
+
+/**
+ * @brief       Drop everything and traverse the directory again.
+ */
+void LinkDaemon::reload()
+{
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+    m_links.clear();
+    m_watches.clear();
+    m_dirs.clear();
+
+    m_inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        throw ::std::system_error(errno, ::std::system_category(),
+                                  "inotify_init1");
+    }
+
+    this->scan(m_root.native());
+}
+
+/**
+ * @brief       Traverse directory, add its links and watches.
+ */
+void LinkDaemon::scan(const ::std::string &dir)
+{
+    try {
+        m_searcher.traverse(
+            dir,
+            [this](const Searcher::Link &link) -> bool {
+                auto path = link.path();
+
+                ::std::unique_lock<::std::mutex> lock(m_lock);
+                m_links.add(::std::move(path), ::std::string(link.raw),
+                            ::std::string(link.linkedTo));
+                return true;
+            },
+            m_onError,
+            [this](const ::std::string &dir, const struct stat &,
+                   const Searcher::PushDirFunc &,
+                   const Searcher::AddLinkFunc &) -> bool {
+                // Watch before scanning, links added meanwhile are seen.
+                this->watch(dir);
+                return false;
+            });
+    } catch (::std::filesystem::filesystem_error &e) {
+        m_onError(e);
+    }
+}
+
+/**
+ * @brief       Scan a new directory and all under it in this thread, add
+ *              their links and watches.
+ */
+void LinkDaemon::scanNew(LinkResolver &resolver, const ::std::string &dir)
+{
+    auto &options = m_searcher.options();
+    auto &devs    = options.targetDevs;
+
+    // Depth-first, a new tree is usually small.
+    ::std::vector<::std::string>           pending {dir};
+    ::std::vector<LinkResolver::BatchLink> links;
+    DirScanner::Entry                      entry;
+    while (! pending.empty()) {
+        auto path = ::std::move(pending.back());
+        pending.pop_back();
+        try {
+            DirScanner scanner(path);
+
+            // Mounted on it meanwhile.
+            struct stat st;
+            if (::fstat(scanner.fd(), &st) < 0) {
+                throw ::std::filesystem::filesystem_error(
+                    "cannot stat", ::std::filesystem::path(path),
+                    ::std::error_code(errno, ::std::system_category()));
+            }
+            if (st.st_dev != m_rootDev
+                && (options.oneFileSystem
+                    || (! devs.empty()
+                        && ::std::find(devs.begin(), devs.end(), st.st_dev)
+                               == devs.end()))) {
+                continue;
+            }
+
+            // Watch before scanning, links added meanwhile are seen.
+            this->watch(path);
+
+            bool checkChildren = m_filter.checkChildren(path);
+            while (scanner.nextBatch()) {
+                links.clear();
+                while (scanner.nextInBatch(entry)) {
+                    try {
+                        auto type = scanner.type(entry);
+                        if (type == DT_LNK) {
+                            links.push_back(LinkResolver::BatchLink {
+                                entry.name, scanner.readLink(entry),
+                                entry.ino, {}, {}});
+                        } else if (type == DT_DIR
+                                   && (! checkChildren
+                                       || ! m_filter.excluded(path,
+                                                              entry.name))) {
+                            pending.push_back(joinPath(path, entry.name));
+                        }
+                    } catch (::std::filesystem::filesystem_error &e) {
+                        m_onError(e);
+                    }
+                }
+
+                resolver.resolveBatch(path, scanner.fd(), links);
+                for (auto &link : links) {
+                    if (link.error) {
+                        m_onError(*link.error);
+                        continue;
+                    }
+                    m_links.add(joinPath(path, link.name),
+                                ::std::move(link.raw),
+                                ::std::move(link.linkedTo));
+                }
+            }
+        } catch (::std::filesystem::filesystem_error &e) {
+            m_onError(e);
+        }
+    }
+}
+
+/**
+ * @brief       Watch directory.
+ */
+bool LinkDaemon::watch(const ::std::string &dir)
+{
+    int wd = ::inotify_add_watch(m_inotifyFd, dir.c_str(), WATCH_MASK);
+    if (wd < 0) {
+        m_onError(::std::filesystem::filesystem_error(
+            "cannot watch", ::std::filesystem::path(dir),
+            ::std::error_code(errno, ::std::system_category())));
+        return false;
+    }
+
+    // Called on traversal threads too.
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    m_watches[wd] = dir;
+    m_dirs[dir]   = wd;
+
+    return true;
+}
+
+/**
+ * @brief       Read link and add it, an old link of the path is removed if
+ *              not a link or not resolved.
+ */
+void LinkDaemon::addLink(LinkResolver        &resolver,
+                         const ::std::string &dir,
+                         ::std::string_view   name)
+{
+    auto    path = joinPath(dir, name);
+    char    buffer[PATH_MAX];
+    ssize_t size = ::readlink(path.c_str(), buffer, sizeof(buffer));
+    if (size < 0) {
+        // Not a link, or removed already, a rename may replace a link.
+        m_links.remove(path);
+        return;
+    }
+
+    try {
+        if (static_cast<::std::size_t>(size) >= sizeof(buffer)) {
+            throw ::std::filesystem::filesystem_error(
+                "cannot read link", ::std::filesystem::path(path),
+                ::std::error_code(ENAMETOOLONG, ::std::system_category()));
+        }
+        ::std::string raw(buffer, static_cast<::std::size_t>(size));
+        auto          linkedTo = resolver.resolve(dir, raw);
+        m_links.add(::std::move(path), ::std::move(raw), ::std::move(linkedTo));
+    } catch (::std::filesystem::filesystem_error &e) {
+        m_links.remove(path);
+        m_onError(e);
+    }
+}
+
+/**
+ * @brief       Remove links and watches of a directory and all under it.
+ */
+void LinkDaemon::removeDir(const ::std::string &dir)
+{
+    m_links.removeUnder(dir);
+
+    // Directories under "DIR" are in ["DIR/", "DIR0").
+    auto          begin  = m_dirs.lower_bound(dir);
+    ::std::string prefix = dir;
+    prefix.push_back('/' + 1);
+    auto end = dir == "/" ? m_dirs.end() : m_dirs.lower_bound(prefix);
+    for (auto iter = begin; iter != end;) {
+        auto &path = iter->first;
+        if (path.size() > dir.size() && path[dir.size()] != '/'
+            && dir != "/") {
+            // "DIR-..." sorts between "DIR" and "DIR/".
+            ++iter;
+            continue;
+        }
+        ::inotify_rm_watch(m_inotifyFd, iter->second);
+        m_watches.erase(iter->second);
+        iter = m_dirs.erase(iter);
+    }
+}
+
+/**
+ * @brief       Read and apply inotify events.
+ */
+void LinkDaemon::handleEvents()
+{
+    alignas(inotify_event) char buffer[EVENT_BUFFER_SIZE];
+
+    // Resolver of this batch, prefixes may have changed since last one.
+    LinkResolver resolver(m_searcher.targets());
+    bool         overflow = false;
+    while (! overflow) {
+        auto size = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN) {
+                break;
+            }
+            throw ::std::system_error(errno, ::std::system_category(),
+                                      "inotify");
+        }
+
+        for (ssize_t offset = 0; offset < size;) {
+            auto event
+                = reinterpret_cast<const struct inotify_event *>(buffer
+                                                                 + offset);
+            offset += static_cast<ssize_t>(sizeof(struct inotify_event)
+                                           + event->len);
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                break;
+            }
+
+            auto iter = m_watches.find(event->wd);
+            if (iter == m_watches.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // Directory removed, or the watch removed by us.
+                auto dirIter = m_dirs.find(iter->second);
+                if (dirIter != m_dirs.end() && dirIter->second == event->wd) {
+                    m_dirs.erase(dirIter);
+                }
+                m_watches.erase(iter);
+                continue;
+            }
+
+            ::std::string      dir  = iter->second;
+            ::std::string_view name = event->len > 0 ? event->name : "";
+            auto               path = joinPath(dir, name);
+            bool               isDir = (event->mask & IN_ISDIR) != 0;
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                if (isDir) {
+                    this->removeDir(path);
+                } else {
+                    m_links.remove(path);
+                }
+            }
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                if (isDir) {
+                    this->removeDir(path);
+                    if (! m_filter.checkChildren(dir)
+                        || ! m_filter.excluded(dir, name)) {
+                        this->scanNew(resolver, path);
+                    }
+                } else {
+                    this->addLink(resolver, dir, name);
+                }
+            }
+        }
+    }
+
+    if (overflow) {
+        this->reload();
+    }
+}
+
+/**
+ * @brief       Answer complete requests in buffer.
+ */
+bool LinkDaemon::handleRequests(int fd, ::std::string &buffer)
+{
+    ::std::string response;
+    ::std::size_t begin = 0;
+    while (true) {
+        auto end = buffer.find('\0', begin);
+        if (end == ::std::string::npos) {
+            break;
+        }
+
+        // Mode and target.
+        if (end == begin || (buffer[begin] != '=' && buffer[begin] != '/')) {
+            return false;
+        }
+        bool               under = (buffer[begin] == '/');
+        ::std::string_view target(buffer.data() + begin + 1, end - begin - 1);
+        begin = end + 1;
+
+        response.clear();
+        m_links.query(target, under,
+                      [&](::std::string_view link, ::std::string_view raw,
+                          ::std::string_view linkedTo) -> void {
+                          response.append(link);
+                          response.push_back('\0');
+                          response.append(raw);
+                          response.push_back('\0');
+                          response.append(linkedTo);
+                          response.push_back('\0');
+                      });
+        response.push_back('\0');
+        if (! sendAll(fd, response)) {
+            return false;
+        }
+    }
+    buffer.erase(0, begin);
+
+    return true;
+}
+
+/**
+ * @brief       Constructor, connect to the daemon.
+ */
+LinkDaemon::Client::Client(const ::std::filesystem::path &socketPath) :
+    m_fd(-1)
+{
+    auto address = socketAddress(socketPath);
+    m_fd         = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        throw ::std::system_error(errno, ::std::system_category(), "socket");
+    }
+    if (::connect(m_fd, reinterpret_cast<struct sockaddr *>(&address),
+                  sizeof(address))
+        < 0) {
+        int err = errno;
+        ::close(m_fd);
+        throw ::std::system_error(err, ::std::system_category(),
+                                  socketPath.native());
+    }
+}
+
+/**
+ * @brief       Destructor.
+ */
+LinkDaemon::Client::~Client()
+{
+    ::close(m_fd);
+}
+
+/**
+ * @brief       Query links pointing to target.
+ */
+void LinkDaemon::Client::query(::std::string_view        target,
+                               bool                      under,
+                               const LinkMap::QueryFunc &func)
+{
+    ::std::string request;
+    request.push_back(under ? '/' : '=');
+    request.append(target);
+    request.push_back('\0');
+    if (! sendAll(m_fd, request)) {
+        throw ::std::system_error(errno, ::std::system_category(), "send");
+    }
+
+    // Records "LINK\0RAW\0TARGET\0", ended by "\0".
+    while (true) {
+        ::std::size_t begin = 0;
+        while (begin < m_buffer.size()) {
+            if (m_buffer[begin] == '\0') {
+                m_buffer.erase(0, begin + 1);
+                return;
+            }
+            auto rawBegin    = m_buffer.find('\0', begin) + 1;
+            auto targetBegin = rawBegin == 0
+                                   ? 0
+                                   : m_buffer.find('\0', rawBegin) + 1;
+            auto end         = targetBegin == 0
+                                   ? ::std::string::npos
+                                   : m_buffer.find('\0', targetBegin);
+            if (end == ::std::string::npos) {
+                break;
+            }
+
+            ::std::string_view data(m_buffer);
+            func(data.substr(begin, rawBegin - 1 - begin),
+                 data.substr(rawBegin, targetBegin - 1 - rawBegin),
+                 data.substr(targetBegin, end - targetBegin));
+            begin = end + 1;
+        }
+        m_buffer.erase(0, begin);
+
+        char data[RECV_SIZE];
+        auto size = ::recv(m_fd, data, sizeof(data), 0);
+        if (size < 0 && errno == EINTR) {
+            continue;
+        } else if (size <= 0) {
+            throw ::std::system_error(size < 0 ? errno : ECONNRESET,
+                                      ::std::system_category(), "recv");
+        }
+        m_buffer.append(data, static_cast<::std::size_t>(size));
+    }
+}
+
+} // namespace findlink
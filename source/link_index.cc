@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <findlink/link_index.h>
+
+namespace findlink {
+
+namespace {
+
+/**
+ * @brief       Write whole buffer to fd.
+ *
+ * @param[in]   fd          File descriptor.
+ * @param[in]   data        Data.
+ * @param[in]   size        Size of data.
+ *
+ * @throw       ::std::system_error
+ */
+void writeAll(int fd, const void *data, ::std::size_t size)
+{
+    auto p = static_cast<const char *>(data);
+    while (size > 0) {
+        auto ret = ::write(fd, p, size);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ::std::system_error(errno, ::std::system_category(),
+                                      "write");
+        }
+        p += ret;
+        size -= static_cast<::std::size_t>(ret);
+    }
+}
+
+/**
+ * @brief       Get time in nanoseconds.
+ *
+ * @param[in]   ts          Time.
+ *
+ * @return      Time in nanoseconds.
+ */
+inline int64_t nanoseconds(const struct timespec &ts)
+{
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000
+           + static_cast<int64_t>(ts.tv_nsec);
+}
+
+} // namespace
+
+/**
+ * @brief       Check if the directory is unchanged.
+ */
+bool LinkIndex::DirRecord::unchanged(const struct stat &st) const
+{
+    return ino != 0 && dev == static_cast<uint64_t>(st.st_dev)
+           && ino == static_cast<uint64_t>(st.st_ino)
+           && mtime == nanoseconds(st.st_mtim)
+           && ctime == nanoseconds(st.st_ctim);
+}
+
+/**
+ * @brief       Add link, thread safe.
+ */
+void LinkIndex::Builder::add(::std::string link,
+                             ::std::string raw,
+                             ::std::string target)
+{
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    m_links.emplace_back(::std::move(target), ::std::move(link),
+                         ::std::move(raw));
+}
+
+/**
+ * @brief       Add directory scanned, thread safe.
+ */
+void LinkIndex::Builder::addDir(::std::string path, const struct stat &st)
+{
+    DirRecord record;
+    ::memset(&record, 0, sizeof(record));
+    record.dev   = static_cast<uint64_t>(st.st_dev);
+    record.ino   = static_cast<uint64_t>(st.st_ino);
+    record.mtime = nanoseconds(st.st_mtim);
+    record.ctime = nanoseconds(st.st_ctim);
+
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    m_dirs.emplace_back(::std::move(path), record);
+}
+
+/**
+ * @brief       Add directory failed to scan, thread safe.
+ */
+void LinkIndex::Builder::addFailedDir(::std::string path)
+{
+    DirRecord record;
+    ::memset(&record, 0, sizeof(record));
+
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    m_dirs.emplace_back(::std::move(path), record);
+}
+
+/**
+ * @brief       Write index file, the file is replaced atomically.
+ */
+void LinkIndex::Builder::write(const ::std::filesystem::path &path,
+                               const ::std::filesystem::path &root)
+{
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    ::std::sort(m_links.begin(), m_links.end());
+    // Failed records sort first of a path and replace the others, a large
+    // directory is scanned by several tasks and any of them may fail.
+    ::std::sort(m_dirs.begin(), m_dirs.end(),
+                [](auto &a, auto &b) -> bool {
+                    return a.first < b.first
+                           || (a.first == b.first
+                               && a.second.ino < b.second.ino);
+                });
+    m_dirs.erase(::std::unique(m_dirs.begin(), m_dirs.end(),
+                               [](auto &a, auto &b) -> bool {
+                                   return a.first == b.first;
+                               }),
+                 m_dirs.end());
+
+    // Link records, links pointing to the same target share it.
+    ::std::string strings(root.native());
+    ::std::vector<Record> records;
+    records.reserve(m_links.size());
+    for (::std::size_t i = 0; i < m_links.size(); ++i) {
+        auto &[target, link, raw] = m_links[i];
+        Record record;
+        ::memset(&record, 0, sizeof(record));
+        if (i > 0 && ::std::get<0>(m_links[i - 1]) == target) {
+            record.targetOffset = records.back().targetOffset;
+        } else {
+            record.targetOffset = strings.size();
+            strings.append(target);
+        }
+        record.targetSize = static_cast<uint32_t>(target.size());
+        record.linkOffset = strings.size();
+        record.linkSize   = static_cast<uint32_t>(link.size());
+        strings.append(link);
+        record.rawOffset = strings.size();
+        record.rawSize   = static_cast<uint32_t>(raw.size());
+        strings.append(raw);
+        records.push_back(record);
+    }
+
+    // Directory records.
+    ::std::vector<DirRecord> dirs;
+    dirs.reserve(m_dirs.size());
+    for (auto &[dirPath, dir] : m_dirs) {
+        dirs.push_back(dir);
+        dirs.back().pathOffset = strings.size();
+        dirs.back().pathSize   = static_cast<uint32_t>(dirPath.size());
+        strings.append(dirPath);
+    }
+
+    Header header;
+    ::memset(&header, 0, sizeof(header));
+    ::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version       = VERSION;
+    header.rootOffset    = 0;
+    header.rootSize      = static_cast<uint32_t>(root.native().size());
+    header.recordCount   = records.size();
+    header.recordsOffset = sizeof(Header);
+    header.dirCount      = dirs.size();
+    header.dirsOffset    = header.recordsOffset
+                        + records.size() * sizeof(Record);
+    header.stringsOffset = header.dirsOffset + dirs.size() * sizeof(DirRecord);
+    header.stringsSize   = strings.size();
+
+    // Empty targets sort first.
+    while (header.unresolvedCount < records.size()
+           && records[header.unresolvedCount].targetSize == 0) {
+        ++header.unresolvedCount;
+    }
+
+    // Write temporary file and rename.
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    if (fd < 0) {
+        throw ::std::system_error(errno, ::std::system_category(),
+                                  tmpPath.native());
+    }
+    try {
+        writeAll(fd, &header, sizeof(header));
+        writeAll(fd, records.data(), records.size() * sizeof(Record));
+        writeAll(fd, dirs.data(), dirs.size() * sizeof(DirRecord));
+        writeAll(fd, strings.data(), strings.size());
+        if (::fsync(fd) < 0) {
+            throw ::std::system_error(errno, ::std::system_category(),
+                                      "fsync");
+        }
+    } catch (...) {
+        ::close(fd);
+        ::unlink(tmpPath.c_str());
+        throw;
+    }
+    ::close(fd);
+
+    if (::rename(tmpPath.c_str(), path.c_str()) < 0) {
+        int err = errno;
+        ::unlink(tmpPath.c_str());
+        throw ::std::system_error(err, ::std::system_category(),
+                                  path.native());
+    }
+}
+
+/**
+ * @brief       Constructor, map index file.
+ */
+LinkIndex::LinkIndex(const ::std::filesystem::path &path) :
+    m_data(nullptr), m_size(0), m_records(nullptr), m_count(0),
+    m_unresolved(0), m_dirs(nullptr), m_dirCount(0), m_strings(nullptr),
+    m_stringsSize(0), m_rootOffset(0), m_rootSize(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw ::std::system_error(errno, ::std::system_category(),
+                                  path.native());
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw ::std::system_error(err, ::std::system_category(),
+                                  path.native());
+    }
+    m_size = static_cast<::std::size_t>(st.st_size);
+    if (m_size < sizeof(Header)) {
+        ::close(fd);
+        throw ::std::runtime_error("\"" + path.native()
+                                   + "\" is not a link index.");
+    }
+
+    auto data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    int  err  = errno;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw ::std::system_error(err, ::std::system_category(),
+                                  path.native());
+    }
+    m_data = static_cast<const char *>(data);
+
+    // Check header.
+    auto header = reinterpret_cast<const Header *>(m_data);
+    if (::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        ::munmap(data, m_size);
+        throw ::std::runtime_error("\"" + path.native()
+                                   + "\" is not a link index.");
+    }
+    if (header->version != VERSION) {
+        ::munmap(data, m_size);
+        throw ::std::runtime_error("\"" + path.native()
+                                   + "\" is built by an incompatible "
+                                     "version, rebuild it.");
+    }
+    if (header->recordsOffset % alignof(Record) != 0
+        || header->recordsOffset > m_size
+        || header->recordCount
+               > (m_size - header->recordsOffset) / sizeof(Record)
+        || header->unresolvedCount > header->recordCount
+        || header->dirsOffset % alignof(DirRecord) != 0
+        || header->dirsOffset > m_size
+        || header->dirCount > (m_size - header->dirsOffset) / sizeof(DirRecord)
+        || header->stringsOffset > m_size
+        || header->stringsSize > m_size - header->stringsOffset) {
+        ::munmap(data, m_size);
+        throw ::std::runtime_error("\"" + path.native()
+                                   + "\" is corrupted.");
+    }
+
+    m_records
+        = reinterpret_cast<const Record *>(m_data + header->recordsOffset);
+    m_count      = header->recordCount;
+    m_unresolved = header->unresolvedCount;
+    m_dirs
+        = reinterpret_cast<const DirRecord *>(m_data + header->dirsOffset);
+    m_dirCount    = header->dirCount;
+    m_strings     = m_data + header->stringsOffset;
+    m_stringsSize = header->stringsSize;
+    m_rootOffset  = header->rootOffset;
+    m_rootSize    = header->rootSize;
+    ::madvise(data, m_size, MADV_RANDOM);
+}
+
+/**
+ * @brief       Destructor, unmap index file.
+ */
+LinkIndex::~LinkIndex()
+{
+    ::munmap(const_cast<char *>(m_data), m_size);
+}
+
+/**
+ * @brief       Query links pointing to target.
+ */
+::std::size_t LinkIndex::query(::std::string_view target,
+                               bool               under,
+                               const QueryFunc   &func) const
+{
+    if (under && target == "/") {
+        this->report(m_unresolved, m_count, func);
+        return m_count - m_unresolved;
+    }
+
+    // Exact.
+    auto begin = this->lowerBound(target);
+    auto end   = begin;
+    while (end < m_count && this->target(m_records[end]) == target) {
+        ++end;
+    }
+    this->report(begin, end, func);
+    ::std::size_t ret = end - begin;
+
+    if (! under) {
+        return ret;
+    }
+
+    // Under, targets start with "TARGET/" are in ["TARGET/", "TARGET0").
+    ::std::string prefix(target);
+    prefix.push_back('/');
+    begin = this->lowerBound(prefix);
+    prefix.back() = '/' + 1;
+    end           = this->lowerBound(prefix);
+    this->report(begin, end, func);
+
+    return ret + (end - begin);
+}
+
+/**
+ * @brief       Iterate all links, unresolved ones first with an empty target.
+ */
+void LinkIndex::forEachLink(const LinkFunc &func) const
+{
+    for (::std::size_t i = 0; i < m_count; ++i) {
+        auto &record = m_records[i];
+        func(this->link(record),
+             this->string(record.rawOffset, record.rawSize),
+             this->target(record));
+    }
+}
+
+/**
+ * @brief       Iterate all directories.
+ */
+void LinkIndex::forEachDir(const DirFunc &func) const
+{
+    for (::std::size_t i = 0; i < m_dirCount; ++i) {
+        auto &record = m_dirs[i];
+        func(this->string(record.pathOffset, record.pathSize), record);
+    }
+}
+
+/**
+ * @brief       Get string in string blob.
+ */
+::std::string_view LinkIndex::string(uint64_t offset, uint32_t size) const
+{
+    if (offset > m_stringsSize || size > m_stringsSize - offset) {
+        throw ::std::runtime_error("Link index is corrupted.");
+    }
+
+    return ::std::string_view(m_strings + offset, size);
+}
+
+/**
+ * @brief       Find first resolved record whose target is not less than
+ *              key.
+ */
+::std::size_t LinkIndex::lowerBound(::std::string_view key) const
+{
+    ::std::size_t begin = m_unresolved;
+    ::std::size_t end   = m_count;
+    while (begin < end) {
+        auto middle = begin + (end - begin) / 2;
+        if (this->target(m_records[middle]) < key) {
+            begin = middle + 1;
+        } else {
+            end = middle;
+        }
+    }
+
+    return begin;
+}
+
+/**
+ * @brief       Report records in range.
+ */
+void LinkIndex::report(::std::size_t    begin,
+                       ::std::size_t    end,
+                       const QueryFunc &func) const
+{
+    for (auto i = begin; i < end; ++i) {
+        auto &record = m_records[i];
+        func(this->link(record),
+             this->string(record.rawOffset, record.rawSize),
+             this->target(record));
+    }
+}
+
+} // namespace findlink
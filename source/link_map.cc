@@ -0,0 +1,117 @@
+#include <findlink/link_map.h>
+
+namespace findlink {
+
+/**
+ * @brief       Add link, an old link of the same path is replaced.
+ */
+void LinkMap::add(::std::string link, ::std::string raw, ::std::string target)
+{
+    this->remove(link);
+
+    auto iter = m_links
+                    .emplace(::std::move(link),
+                             Link {::std::move(raw), ::std::move(target)})
+                    .first;
+    m_targets.emplace(iter->second.target, iter->first, iter->second.raw);
+}
+
+/**
+ * @brief       Remove link.
+ */
+void LinkMap::remove(::std::string_view link)
+{
+    auto iter = m_links.find(link);
+    if (iter != m_links.end()) {
+        this->erase(iter, ::std::next(iter));
+    }
+}
+
+/**
+ * @brief       Remove all links under a directory.
+ */
+void LinkMap::removeUnder(::std::string_view dir)
+{
+    if (dir == "/") {
+        this->clear();
+        return;
+    }
+
+    // Links under "DIR" are in ["DIR/", "DIR0").
+    ::std::string prefix(dir);
+    prefix.push_back('/');
+    auto begin    = m_links.lower_bound(prefix);
+    prefix.back() = '/' + 1;
+    this->erase(begin, m_links.lower_bound(prefix));
+}
+
+/**
+ * @brief       Remove all links.
+ */
+void LinkMap::clear()
+{
+    m_targets.clear();
+    m_links.clear();
+}
+
+/**
+ * @brief       Query links pointing to target.
+ */
+::std::size_t LinkMap::query(::std::string_view target,
+                             bool               under,
+                             const QueryFunc   &func) const
+{
+    if (under && target == "/") {
+        return this->report(m_targets.begin(), m_targets.end(), func);
+    }
+
+    // Exact.
+    auto begin = m_targets.lower_bound({target, {}, {}});
+    auto end   = begin;
+    while (end != m_targets.end() && ::std::get<0>(*end) == target) {
+        ++end;
+    }
+    auto ret = this->report(begin, end, func);
+
+    if (! under) {
+        return ret;
+    }
+
+    // Under, targets start with "TARGET/" are in ["TARGET/", "TARGET0").
+    ::std::string prefix(target);
+    prefix.push_back('/');
+    begin         = m_targets.lower_bound({prefix, {}, {}});
+    prefix.back() = '/' + 1;
+    end           = m_targets.lower_bound({prefix, {}, {}});
+
+    return ret + this->report(begin, end, func);
+}
+
+/**
+ * @brief       Remove links in range.
+ */
+void LinkMap::erase(Links::iterator begin, Links::iterator end)
+{
+    for (auto iter = begin; iter != end; ++iter) {
+        m_targets.erase({iter->second.target, iter->first, iter->second.raw});
+    }
+    m_links.erase(begin, end);
+}
+
+/**
+ * @brief       Report links in range of index.
+ */
+::std::size_t LinkMap::report(TargetIndex::const_iterator begin,
+                              TargetIndex::const_iterator end,
+                              const QueryFunc            &func) const
+{
+    ::std::size_t ret = 0;
+    for (auto iter = begin; iter != end; ++iter, ++ret) {
+        auto &[target, link, raw] = *iter;
+        func(link, raw, target);
+    }
+
+    return ret;
+}
+
+} // namespace findlink
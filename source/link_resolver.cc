@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <filesystem>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <findlink/byte_string.h>
+#include <findlink/link_resolver.h>
+
+namespace findlink {
+
+namespace {
+
+/**
+ * @brief       Throw filesystem error.
+ *
+ * @param[in]   path        Path.
+ * @param[in]   err         Error number.
+ */
+[[noreturn]] void throwError(::std::string_view path, int err)
+{
+    throw ::std::filesystem::filesystem_error(
+        "cannot resolve link", ::std::filesystem::path(path),
+        ::std::error_code(err, ::std::system_category()));
+}
+
+/**
+ * @brief       Join directory and name.
+ *
+ * @param[in]   dir         Directory.
+ * @param[in]   name        Name.
+ *
+ * @return      Path.
+ */
+::std::string joinPath(::std::string_view dir, ::std::string_view name)
+{
+    ::std::string ret;
+    ret.reserve(dir.size() + name.size() + 1);
+    ret.append(dir);
+    if (ret.size() > 1) {
+        ret.push_back('/');
+    }
+    ret.append(name);
+
+    return ret;
+}
+
+} // namespace
+
+/**
+ * @brief       Constructor.
+ */
+LinkResolver::LinkResolver(const TargetSet &targets, Stats *stats) :
+    m_targets(targets), m_stats(stats)
+{}
+
+/**
+ * @brief       Resolve link.
+ */
+::std::string LinkResolver::resolve(::std::string_view dir,
+                                    ::std::string_view link)
+{
+    int depth = 0;
+    return this->resolveAt(dir, link, depth);
+}
+
+/**
+ * @brief       Resolve link found in a directory, a link already resolved
+ *              as part of another chain is not resolved again.
+ */
+::std::string LinkResolver::resolve(::std::string_view dir,
+                                    ::std::string_view name,
+                                    ::std::string_view link)
+{
+    auto          path = joinPath(dir, name);
+    ::std::string resolved;
+    if (this->fromCache(path, resolved)) {
+        return resolved;
+    }
+
+    return this->resolve(dir, link);
+}
+
+/**
+ * @brief       Resolve sibling links found in a directory.
+ */
+void LinkResolver::resolveBatch(::std::string_view        dir,
+                                int                       dirFd,
+                                ::std::vector<BatchLink> &links)
+{
+    /**
+     * @brief       Last component left to check.
+     */
+    struct Leaf {
+        ::std::size_t index;  ///< Index of link.
+        ::std::string path;   ///< Canonical parent and last component.
+        ::std::size_t parent; ///< Size of parent in path.
+    };
+    ::std::vector<Leaf> leaves;
+
+    // Resolve parents, most are cached or known.
+    for (::std::size_t i = 0; i < links.size(); ++i) {
+        auto &link = links[i];
+        try {
+            if (this->fromCache(joinPath(dir, link.name), link.linkedTo)) {
+                continue;
+            }
+
+            ::std::string_view raw  = link.raw;
+            auto               pos  = raw.rfind('/');
+            auto               last = pos == ::std::string_view::npos
+                                          ? raw
+                                          : raw.substr(pos + 1);
+            if (last.empty() || last == "." || last == "..") {
+                link.linkedTo = this->resolve(dir, raw);
+                continue;
+            }
+
+            ::std::string parent;
+            if (pos == ::std::string_view::npos) {
+                parent = dir;
+            } else {
+                int  depth = 0;
+                auto head  = raw.substr(0, pos == 0 ? 1 : pos);
+                parent     = this->resolveAt(dir, head, depth);
+            }
+            auto path = joinPath(parent, last);
+            if (this->isKnown(path, dir, true)
+                || this->fromCache(path, path)) {
+                link.linkedTo = ::std::move(path);
+                continue;
+            }
+            leaves.push_back(Leaf {i, ::std::move(path), parent.size()});
+        } catch (::std::filesystem::filesystem_error &e) {
+            link.error = e;
+        }
+    }
+
+    // Check last components, by a single fd of each parent shared by
+    // several links, the fd of the directory scanned is reused.
+    ::std::sort(leaves.begin(), leaves.end(),
+                [](const Leaf &a, const Leaf &b) -> bool {
+                    return ::std::string_view(a.path).substr(0, a.parent)
+                           < ::std::string_view(b.path).substr(0, b.parent);
+                });
+    for (::std::size_t begin = 0; begin < leaves.size();) {
+        auto parent = ::std::string_view(leaves[begin].path)
+                          .substr(0, leaves[begin].parent);
+        auto end    = begin + 1;
+        while (end < leaves.size()
+               && ::std::string_view(leaves[end].path)
+                          .substr(0, leaves[end].parent)
+                      == parent) {
+            ++end;
+        }
+
+        int  fd    = -1;
+        bool owned = false;
+        if (dirFd >= 0 && parent == dir) {
+            fd = dirFd;
+        } else if (end - begin > 1) {
+            if (m_stats != nullptr) {
+                Stats::add(m_stats->local().resolveSyscalls);
+            }
+            fd    = ::open(::std::string(parent).c_str(),
+                           O_PATH | O_DIRECTORY | O_CLOEXEC);
+            owned = fd >= 0;
+        }
+        for (; begin < end; ++begin) {
+            auto &leaf = leaves[begin];
+            auto &link = links[leaf.index];
+            try {
+                if (m_stats != nullptr) {
+                    Stats::add(m_stats->local().resolveSyscalls);
+                }
+                struct stat st;
+                auto        name = leaf.path.c_str() + leaf.parent
+                            + (leaf.parent > 1 ? 1 : 0);
+                if ((fd >= 0
+                         ? ::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW)
+                         : ::lstat(leaf.path.c_str(), &st))
+                    < 0) {
+                    throwError(leaf.path, errno);
+                }
+
+                if (S_ISLNK(st.st_mode)) {
+                    // Follow the chain, its links are cached.
+                    link.linkedTo = this->resolve(dir, link.raw);
+                } else {
+                    if (S_ISDIR(st.st_mode)) {
+                        m_cache.insert(leaf.path,
+                                       Resolution {leaf.path, 0, false});
+                    }
+                    link.linkedTo = ::std::move(leaf.path);
+                }
+            } catch (::std::filesystem::filesystem_error &e) {
+                link.error = e;
+            }
+        }
+        if (owned) {
+            ::close(fd);
+        }
+    }
+}
+
+/**
+ * @brief       Resolve path relative to a canonical directory.
+ */
+::std::string LinkResolver::resolveAt(::std::string_view dir,
+                                      ::std::string_view path,
+                                      int               &depth)
+{
+    ::std::string resolved;
+    if (! path.empty() && path[0] == '/') {
+        resolved.assign(1, '/');
+    } else {
+        resolved = dir;
+    }
+
+    ::std::size_t begin = 0;
+    while (begin < path.size()) {
+        // Split component.
+        auto end = path.find('/', begin);
+        if (end == ::std::string_view::npos) {
+            end = path.size();
+        }
+        auto component = path.substr(begin, end - begin);
+        bool last      = (end == path.size());
+        begin          = end + 1;
+
+        if (component.empty() || component == ".") {
+            continue;
+        } else if (component == "..") {
+            // Parent of a canonical directory is canonical.
+            auto pos = resolved.rfind('/');
+            resolved.resize(pos == 0 ? 1 : pos);
+            continue;
+        }
+
+        auto parentSize = resolved.size();
+        if (resolved.size() > 1) {
+            resolved.push_back('/');
+        }
+        resolved.append(component);
+
+        // Lexical check.
+        if (this->isKnown(resolved, dir, last)) {
+            continue;
+        }
+
+        // Cached prefix or link.
+        if (this->fromCache(resolved, resolved)) {
+            continue;
+        }
+
+        // Real resolution.
+        if (m_stats != nullptr) {
+            Stats::add(m_stats->local().resolveSyscalls);
+        }
+        struct stat st;
+        if (::lstat(resolved.c_str(), &st) < 0) {
+            throwError(resolved, errno);
+        }
+
+        if (S_ISLNK(st.st_mode)) {
+            if (++depth > MAX_LINK_DEPTH) {
+                throwError(resolved, ELOOP);
+            }
+
+            if (m_stats != nullptr) {
+                Stats::add(m_stats->local().linkMisses);
+                Stats::add(m_stats->local().resolveSyscalls);
+            }
+            char    buffer[PATH_MAX];
+            ssize_t size = ::readlink(resolved.c_str(), buffer, PATH_MAX);
+            if (size < 0) {
+                throwError(resolved, errno);
+            } else if (size >= PATH_MAX) {
+                throwError(resolved, ENAMETOOLONG);
+            }
+            ::std::string linkResolved;
+            try {
+                linkResolved = this->resolveAt(
+                    ::std::string_view(resolved).substr(0, parentSize),
+                    ::std::string_view(buffer,
+                                       static_cast<::std::size_t>(size)),
+                    depth);
+            } catch (::std::filesystem::filesystem_error &e) {
+                // Loops depend on the depth reached, retry them.
+                if (e.code().value() != ELOOP) {
+                    m_cache.insert(resolved, Resolution {e.path1().native(),
+                                                         e.code().value(),
+                                                         true});
+                }
+                throw;
+            }
+
+            m_cache.insert(resolved, Resolution {linkResolved, 0, true});
+            resolved = ::std::move(linkResolved);
+
+        } else if (S_ISDIR(st.st_mode)) {
+            m_cache.insert(resolved, Resolution {resolved, 0, false});
+        } else if (! last) {
+            throwError(resolved, ENOTDIR);
+        }
+    }
+
+    return resolved;
+}
+
+/**
+ * @brief       Take a resolution from the cache.
+ */
+bool LinkResolver::fromCache(const ::std::string &path,
+                             ::std::string       &resolved)
+{
+    auto cached = m_cache.find(path);
+    if (! cached) {
+        return false;
+    }
+
+    if (m_stats != nullptr) {
+        if (cached->link) {
+            Stats::add(m_stats->local().linkHits);
+        } else {
+            Stats::add(m_stats->local().prefixHits);
+        }
+    }
+    if (cached->error != 0) {
+        throwError(cached->path, cached->error);
+    }
+    resolved = ::std::move(cached->path);
+
+    return true;
+}
+
+/**
+ * @brief       Check if a path is known to be canonical and existing
+ *              without syscalls.
+ */
+bool LinkResolver::isKnown(::std::string_view path,
+                           ::std::string_view dir,
+                           bool               last) const
+{
+    if (isPathPrefix(dir, path)) {
+        return true;
+    }
+
+    // Ancestors of targets are directories, targets themselves may not be.
+    return m_targets.isAncestor(path) || (last && m_targets.find(path));
+}
+
+} // namespace findlink
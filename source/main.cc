@@ -1,15 +1,39 @@
+#include <algorithm>
 #include <atomic>
-#include <condition_variable>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <functional>
-#include <mutex>
-#include <queue>
+#include <iterator>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include <dirent.h>
 #include <getopt.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <findlink/cluster.h>
+#include <findlink/cpu_count.h>
+#include <findlink/link_daemon.h>
+#include <findlink/link_index.h>
+#include <findlink/output_sink.h>
+#include <findlink/record_writer.h>
+#include <findlink/searcher.h>
+#include <findlink/stats.h>
+#include <findlink/stats_reporter.h>
+#include <findlink/target_set.h>
+#include <findlink/tracer.h>
+#include <findlink/uring_engine.h>
 
 /**
  * @brief       Print usage.
@@ -19,155 +43,1063 @@
 void usage(const char *name)
 {
     printf("Usage:\n"
-           "    %s TARGET SEARCH_DIR\n"
+           "    %s [OPTIONS] TARGET... SEARCH_DIR\n"
+           "    %s [OPTIONS] --targets-from FILE [TARGET...] SEARCH_DIR\n"
+           "    %s [OPTIONS] --target-glob PATTERN [TARGET...] SEARCH_DIR\n"
+           "    %s index build [OPTIONS] INDEX SEARCH_DIR\n"
+           "    %s index query [OPTIONS] INDEX TARGET...\n"
+           "    %s index refresh [OPTIONS] INDEX\n"
+           "    %s daemon serve [OPTIONS] SOCKET SEARCH_DIR\n"
+           "    %s daemon query [OPTIONS] SOCKET TARGET...\n"
+           "    %s cluster coordinate [OPTIONS] PORT TARGET... SEARCH_DIR\n"
+           "    %s cluster worker [OPTIONS] HOST PORT\n"
            "    %s -h\n"
            "\n"
-           "Search symbol links point to the target.\n"
+           "Search symbol links point to the targets. When more than one\n"
+           "target is given, each link is printed as \"LINK<TAB>TARGET\".\n"
+           "\n"
+           "\"index build\" resolves all links in SEARCH_DIR and saves them\n"
+           "in INDEX, \"index query\" searches INDEX instead of the tree.\n"
+           "\"index refresh\" updates INDEX, only directories changed since\n"
+           "last build are scanned.\n"
+           "\n"
+           "\"daemon serve\" resolves all links in SEARCH_DIR once, keeps\n"
+           "them current by inotify and answers queries on the Unix socket\n"
+           "SOCKET until SIGINT or SIGTERM. \"daemon query\" asks it.\n"
+           "Links are resolved when created, a link whose target is\n"
+           "created later is not found until the link is recreated.\n"
+           "\n"
+           "\"cluster coordinate\" splits SEARCH_DIR by subdirectory and\n"
+           "hands them to \"cluster worker\" processes connecting to PORT,\n"
+           "links found are printed by the coordinator. SEARCH_DIR must be\n"
+           "mounted at the same path on all hosts. A subdirectory whose\n"
+           "worker is lost is handed to another one. Both sides need\n"
+           "--secret-file, the secret and all traffic are sent in clear,\n"
+           "so run them on a trusted network or through a tunnel.\n"
            "\n"
            "Optional Arguments:\n"
            "    -h, --help           Show this help.\n"
+           "    -j, --threads THREADS\n"
+           "                         Number of search threads, \"auto\" to\n"
+           "                         use the CPU count allowed by affinity\n"
+           "                         and cgroup quota. Default is \"auto\".\n"
+           "    --max-threads THREADS\n"
+           "                         Grow the thread pool up to THREADS\n"
+           "                         while threads are blocked on I/O,\n"
+           "                         \"auto\" for 8 times the CPU count.\n"
+           "                         Default is not to grow.\n"
+           "    --engine ENGINE      Search engine, \"threads\" for a thread\n"
+           "                         pool, \"uring\" for a single thread\n"
+           "                         keeping many directory opens in\n"
+           "                         flight with io_uring. Default is\n"
+           "                         \"threads\".\n"
+           "    --targets-from FILE  Read targets from FILE, one per line.\n"
+           "    --target-glob PATTERN\n"
+           "                         Match links pointing to paths\n"
+           "                         matching glob PATTERN, \"*\" matches\n"
+           "                         \"/\" too. Can be given more than\n"
+           "                         once.\n"
+           "    --under              Match links pointing to the targets or\n"
+           "                         anywhere under them.\n"
+           "    -0, --null           Terminate each link printed by NUL\n"
+           "                         instead of newline.\n"
+           "    --max-memory SIZE    Bound memory of directories pending\n"
+           "                         to about SIZE, suffix K, M and G are\n"
+           "                         accepted. Directories found beyond\n"
+           "                         it are scanned depth-first at once.\n"
+           "                         Default is unbounded.\n"
+           "    -x, --one-file-system\n"
+           "                         Do not descend into directories on\n"
+           "                         other filesystems.\n"
+           "    --exclude PATTERN    Do not descend into directories\n"
+           "                         matching PATTERN. A pattern without\n"
+           "                         \"*?[\" is a path, a pattern with \"/\"\n"
+           "                         is a glob on full path, others are\n"
+           "                         globs on directory name. Can be given\n"
+           "                         more than once.\n"
+           "    --ignore-mounts FILE\n"
+           "                         Do not descend into mount points\n"
+           "                         listed in FILE, one path or\n"
+           "                         filesystem type such as \"squashfs\"\n"
+           "                         per line, \"#\" starts a comment.\n"
+           "    --prune-by-target-dev\n"
+           "                         Do not descend into filesystems other\n"
+           "                         than those of SEARCH_DIR and the\n"
+           "                         targets, when links are known to be\n"
+           "                         on the filesystem of their target.\n"
+           "                         Ignored with --target-glob.\n"
+           "    --format FORMAT      Output format, \"text\" for paths,\n"
+           "                         \"jsonl\" for JSON Lines, \"binary\" for\n"
+           "                         length-prefixed records. Records of\n"
+           "                         \"jsonl\" and \"binary\" carry the link,\n"
+           "                         raw link target, resolved target,\n"
+           "                         target matched, dev and ino, errors\n"
+           "                         are written as records too. Default\n"
+           "                         is \"text\".\n"
+           "    --stats              Print traversal metrics to stderr at\n"
+           "                         end.\n"
+           "    --stats-file FILE    Export traversal metrics to FILE every\n"
+           "                         second, one \"NAME VALUE\" per line.\n"
+           "    --progress           Print directories, entries per second,\n"
+           "                         links matched and directories queued\n"
+           "                         to stderr every second.\n"
+           "    --trace-summary      Print latency percentiles of directory\n"
+           "                         scans, link reads and resolutions,\n"
+           "                         and the slowest directories to stderr\n"
+           "                         at end. Needs a build with\n"
+           "                         ENABLE_TRACING.\n"
+           "    --trace FILE         Write operations taking 1 ms or more\n"
+           "                         to FILE as Chrome trace events. Needs\n"
+           "                         a build with ENABLE_TRACING.\n"
+           "    --first              Stop at the first link found.\n"
+           "    --max-results COUNT  Stop after COUNT links are found.\n"
+           "    -q, --quiet          Print no link, stop at the first one\n"
+           "                         found and exit with 1 if none.\n"
+           "    --visit-once         Scan each directory once by device\n"
+           "                         and inode, when it is reachable\n"
+           "                         through bind mounts or overlays.\n"
+           "    --dedup-links        Report each link once by device,\n"
+           "                         inode and resolved target, when it is\n"
+           "                         reachable through bind mounts. Hard\n"
+           "                         links of a link are reported once per\n"
+           "                         target they resolve to.\n"
+           "    --bind ADDRESS       Address \"cluster coordinate\" listens\n"
+           "                         on. Default is every address.\n"
+           "    --secret-file FILE   Read the secret \"cluster worker\"\n"
+           "                         sends to \"cluster coordinate\" from\n"
+           "                         FILE. Required by both.\n"
+           "\n"
+           "Mount points of pseudo filesystems such as proc, sysfs and cgroup\n"
+           "under SEARCH_DIR are never searched.\n"
            "\n"
            "Positional Arguments:\n"
            "    TARGET               Target of links.\n"
-           "    SEARCH_DIR           Directory to search.\n",
-           name, name);
+           "    SEARCH_DIR           Directory to search.\n"
+           "    PORT                 TCP port of coordinator.\n"
+           "    HOST                 Host of coordinator.\n",
+           name, name, name, name, name, name, name, name, name, name, name);
+}
+
+/// Estimated memory of a pending directory, node with name and queue slot.
+constexpr ::std::size_t PENDING_DIR_COST = 128;
+
+/// Interval to export metrics.
+constexpr ::std::chrono::milliseconds STATS_INTERVAL {1000};
+
+/**
+ * @brief       Command options.
+ */
+struct CommandOptions {
+    ::findlink::SearchOptions search;       ///< Search options.
+    bool                      null = false; ///< Terminate output by NUL.
+
+    /// Output format.
+    ::findlink::RecordWriter::Format format
+        = ::findlink::RecordWriter::Format::TEXT;
+
+    bool          stats    = false; ///< Print metrics.
+    bool          progress = false; ///< Print progress status.
+    ::std::string statsFile;        ///< File to export metrics to.
+
+    bool          traceSummary = false; ///< Print latency summary.
+    ::std::string traceFile;            ///< File to write trace events to.
+
+    /// Links to report at most, 0 for unlimited.
+    ::std::size_t maxResults = 0;
+
+    bool quiet = false; ///< Report existence by exit code only.
+
+    /// Skip directories on other devices than the targets.
+    bool pruneByTargetDev = false;
+
+    ::std::string bindAddress; ///< Address of coordinator, empty for any.
+    ::std::string secret;      ///< Secret shared by cluster hosts.
+};
+
+/// Slowest directories in latency summary.
+constexpr ::std::size_t TRACE_TOP_COUNT = 20;
+
+/// Operations at least this long are written as trace events.
+constexpr ::std::chrono::microseconds TRACE_EVENT_MIN {1000};
+
+/**
+ * @brief       Metrics of a command, reported while alive.
+ */
+struct CommandStats {
+    ::std::unique_ptr<::findlink::Stats>         stats;    ///< Stats.
+    ::std::unique_ptr<::findlink::StatsReporter> reporter; ///< Reporter.
+    ::std::unique_ptr<::findlink::Tracer>        tracer;   ///< Tracer.
+    const CommandOptions                        &options;  ///< Options.
+
+    /**
+     * @brief       Constructor, stats are counted in if asked.
+     *
+     * @param[in]   options     Command options.
+     * @param[out]  search      Search options to count in.
+     */
+    CommandStats(const CommandOptions      &options,
+                 ::findlink::SearchOptions &search) :
+        options(options)
+    {
+        if (options.stats || options.progress || ! options.statsFile.empty()) {
+            stats    = ::std::make_unique<::findlink::Stats>();
+            reporter = ::std::make_unique<::findlink::StatsReporter>(
+                *stats, options.statsFile, STATS_INTERVAL, options.stats,
+                options.progress);
+        }
+        search.stats = stats.get();
+
+        if (options.traceSummary || ! options.traceFile.empty()) {
+            tracer = ::std::make_unique<::findlink::Tracer>(TRACE_TOP_COUNT,
+                                                            TRACE_EVENT_MIN);
+        }
+        search.tracer = tracer.get();
+    }
+
+    /**
+     * @brief       Destructor, report latencies.
+     */
+    ~CommandStats()
+    {
+        if (! tracer) {
+            return;
+        }
+        if (options.traceSummary) {
+            fprintf(stderr, "%s", tracer->summary().c_str());
+        }
+        if (! options.traceFile.empty()
+            && ! tracer->writeTrace(options.traceFile)) {
+            fprintf(stderr, "Failed to write \"%s\".\n",
+                    options.traceFile.c_str());
+        }
+    }
+};
+
+/**
+ * @brief       Parse thread count.
+ *
+ * @param[in]   str         String to parse.
+ * @param[out]  count       Thread count, 0 for "auto".
+ *
+ * @return      \c true on success, \c false if illegal.
+ */
+bool parseThreadCount(const char *str, unsigned int &count)
+{
+    if (strcmp(str, "auto") == 0) {
+        count = 0;
+        return true;
+    }
+
+    char *end;
+    errno      = 0;
+    auto value = strtoul(str, &end, 10);
+    if (errno != 0 || end == str || *end != '\0' || value == 0
+        || value > 65536) {
+        return false;
+    }
+    count = static_cast<unsigned int>(value);
+
+    return true;
+}
+
+/**
+ * @brief       Parse memory size.
+ *
+ * @param[in]   str         String to parse.
+ * @param[out]  size        Size in bytes.
+ *
+ * @return      \c true on success, \c false if illegal.
+ */
+bool parseMemorySize(const char *str, ::std::size_t &size)
+{
+    char *end;
+    errno      = 0;
+    auto value = strtoull(str, &end, 10);
+    if (errno != 0 || end == str || value == 0) {
+        return false;
+    }
+
+    unsigned int shift = 0;
+    switch (*end) {
+        case '\0':
+            break;
+
+        case 'k':
+        case 'K':
+            shift = 10;
+            break;
+
+        case 'm':
+        case 'M':
+            shift = 20;
+            break;
+
+        case 'g':
+        case 'G':
+            shift = 30;
+            break;
+
+        default:
+            return false;
+    }
+    if (*end != '\0' && end[1] != '\0') {
+        return false;
+    }
+    if (value > (SIZE_MAX >> shift)) {
+        return false;
+    }
+    size = static_cast<::std::size_t>(value) << shift;
+
+    return true;
+}
+
+/**
+ * @brief       Add target.
+ *
+ * @param[out]  targets     Target set.
+ * @param[in]   target      Target to add.
+ *
+ * @return      \c true on success, \c false if the target cannot be found.
+ */
+bool addTarget(::findlink::TargetSet &targets, const ::std::string &target)
+{
+    ::std::error_code ec;
+    auto              path = ::std::filesystem::canonical(target, ec);
+    if (ec) {
+        fprintf(stderr, "Cannot find target \"%s\": %s.\n", target.c_str(),
+                ec.message().c_str());
+        return false;
+    }
+    targets.add(path.native());
+
+    return true;
+}
+
+/**
+ * @brief       Add devices of targets to prune by, if enabled.
+ *
+ * @param[in, out]  options     Command options.
+ * @param[in]       targets     Targets.
+ */
+void addTargetDevs(CommandOptions              &options,
+                   const ::findlink::TargetSet &targets)
+{
+    if (! options.pruneByTargetDev || ! options.search.targetGlobs.empty()) {
+        return;
+    }
+
+    auto &devs = options.search.targetDevs;
+    for (auto &target : targets) {
+        struct stat st;
+        if (::stat(target.c_str(), &st) == 0
+            && ::std::find(devs.begin(), devs.end(), st.st_dev)
+                   == devs.end()) {
+            devs.push_back(st.st_dev);
+        }
+    }
+}
+
+/**
+ * @brief       Load targets from file.
+ *
+ * @param[out]  targets     Targets read.
+ * @param[in]   file        File to read, one target per line.
+ *
+ * @return      \c true on success, \c false if the file cannot be read.
+ */
+bool loadTargets(::std::vector<::std::string> &targets, const char *file)
+{
+    ::std::ifstream stream(file);
+    if (! stream) {
+        fprintf(stderr, "Cannot open \"%s\".\n", file);
+        return false;
+    }
+
+    ::std::string line;
+    while (::std::getline(stream, line)) {
+        if (! line.empty()) {
+            targets.push_back(::std::move(line));
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief       Load cluster secret from file.
+ *
+ * @param[out]  secret      Secret, trailing newlines are removed.
+ * @param[in]   file        File to read.
+ *
+ * @return      \c true on success, \c false if the file cannot be read or
+ *              is empty.
+ */
+bool loadSecret(::std::string &secret, const char *file)
+{
+    ::std::ifstream stream(file, ::std::ios::binary);
+    if (! stream) {
+        fprintf(stderr, "Cannot open \"%s\".\n", file);
+        return false;
+    }
+
+    secret.assign(::std::istreambuf_iterator<char>(stream),
+                  ::std::istreambuf_iterator<char>());
+    while (! secret.empty()
+           && (secret.back() == '\n' || secret.back() == '\r')) {
+        secret.pop_back();
+    }
+    if (secret.empty()) {
+        fprintf(stderr, "Secret file \"%s\" is empty.\n", file);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief       Load mount points to ignore from file.
+ *
+ * @param[out]  options     Search options, paths are added to excludes and
+ *                          filesystem types to excluded types.
+ * @param[in]   file        File to read, one path or type per line.
+ *
+ * @return      \c true on success, \c false if the file cannot be read.
+ */
+bool loadIgnoredMounts(::findlink::SearchOptions &options, const char *file)
+{
+    ::std::ifstream stream(file);
+    if (! stream) {
+        fprintf(stderr, "Cannot open \"%s\".\n", file);
+        return false;
+    }
+
+    ::std::string line;
+    while (::std::getline(stream, line)) {
+        line.erase(::std::min(line.find('#'), line.size()));
+        auto begin = line.find_first_not_of(" \t");
+        if (begin == ::std::string::npos) {
+            continue;
+        }
+        line = line.substr(begin, line.find_last_not_of(" \t") + 1 - begin);
+
+        if (line[0] == '/') {
+            options.excludes.push_back(::std::move(line));
+        } else {
+            options.excludeFsTypes.push_back(::std::move(line));
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief       Print error.
+ *
+ * @param[in]   e           Error.
+ */
+void printError(const ::std::filesystem::filesystem_error &e)
+{
+    fprintf(stderr, "%s\n", e.what());
+}
+
+/**
+ * @brief       Flush output.
+ *
+ * @param[in]   output      Output.
+ * @param[in]   ret         Exit code.
+ *
+ * @return      Exit code, 1 if writing failed.
+ */
+int flushOutput(::findlink::OutputSink &output, int ret)
+{
+    output.flush();
+    if (output.failed()) {
+        fprintf(stderr, "Failed to write output.\n");
+        return 1;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Count a link found in a query.
+ *
+ * @param[in]       options     Command options.
+ * @param[in, out]  found       Links found.
+ *
+ * @return      \c true if the link should be written, \c false if not.
+ */
+bool reportResult(const CommandOptions &options, ::std::size_t &found)
+{
+    ++found;
+    return ! options.quiet
+           && (options.maxResults == 0 || found <= options.maxResults);
 }
 
 /**
  * @brief       Do search.
  *
- * @param[in]   target      Link target.
+ * @param[in]   targets     Link targets.
  * @param[in]   searchDir   Search directory.
+ * @param[in]   options     Command options.
  *
  * @return      Exit code.
  */
-int doSearch(const ::std::filesystem::path &target,
-             const ::std::filesystem::path &searchDir)
+int doSearch(::findlink::TargetSet          targets,
+             const ::std::filesystem::path &searchDir,
+             const CommandOptions          &options)
 {
-    // Check exists.
-    if (! ::std::filesystem::exists(searchDir)) {
-        fprintf(stderr, "\"%s\" does not exists.\n", searchDir.c_str());
-        return 1;
+    ::findlink::OutputSink   output(STDOUT_FILENO, options.null ? '\0' : '\n');
+    ::findlink::RecordWriter writer(
+        output, options.format,
+        targets.size() + options.search.targetGlobs.size() > 1);
+
+    auto         search = options.search;
+    CommandStats stats(options, search);
+    search.statDirs
+        = (options.format != ::findlink::RecordWriter::Format::TEXT);
+    ::findlink::Searcher searcher(::std::move(targets), ::std::move(search));
+
+    // Links beyond the limit found by other threads meanwhile are dropped.
+    ::std::atomic<::std::size_t> found(0);
+    try {
+        searcher.search(
+            searchDir,
+            [&](const ::findlink::Searcher::Link &link) -> bool {
+                auto count = found.fetch_add(1) + 1;
+                if (options.maxResults != 0 && count > options.maxResults) {
+                    return false;
+                }
+                if (! options.quiet) {
+                    writer.writeLink(::findlink::RecordWriter::Link {
+                        link.path(), link.raw, link.linkedTo, link.matched,
+                        link.dev, link.ino});
+                }
+                return options.maxResults == 0 || count < options.maxResults;
+            },
+            [&](const ::std::filesystem::filesystem_error &e) -> void {
+                writer.writeError(e);
+            });
+    } catch (::std::filesystem::filesystem_error &e) {
+        printError(e);
+        return flushOutput(output, 1);
     }
 
-    struct SearchTask {
-        const ::std::filesystem::path &target;
-        ::std::filesystem::path        searchDir;
+    return flushOutput(output, options.quiet && found.load() == 0 ? 1 : 0);
+}
+
+/**
+ * @brief       Build link index.
+ *
+ * @param[in]   indexPath   Path of index file.
+ * @param[in]   searchDir   Search directory.
+ * @param[in]   options     Command options.
+ * @param[in]   old         Index to refresh, \c nullptr to build from
+ *                          scratch.
+ *
+ * @return      Exit code.
+ */
+int doIndexBuild(const ::std::filesystem::path &indexPath,
+                 const ::std::filesystem::path &searchDir,
+                 const CommandOptions          &options,
+                 const ::findlink::LinkIndex   *old = nullptr)
+{
+    /**
+     * @brief       Directory in old index.
+     */
+    struct OldDir {
+        const ::findlink::LinkIndex::DirRecord *record; ///< Record.
+
+        /// Names of subdirectories.
+        ::std::vector<::std::string_view> children;
+
+        /// Links, (name, raw link target).
+        ::std::vector<::std::pair<::std::string_view, ::std::string>> links;
     };
-    ::std::mutex                                queueLock;
-    ::std::condition_variable                   queueCond;
-    ::std::queue<::std::unique_ptr<SearchTask>> taskQueue;
-
-    // Search task.
-    auto searchTaskFunc = [&](const ::std::filesystem::path &target,
-                              ::std::filesystem::path searchDir) -> void {
-        // Check type.
-        if (! ::std::filesystem::is_directory(searchDir)) {
-            if (::std::filesystem::is_symlink(searchDir)) {
-                try {
-                    auto linkedTo = ::std::filesystem::read_symlink(searchDir);
-                    if (linkedTo.is_absolute()) {
-                        linkedTo = ::std::filesystem::canonical(linkedTo);
-                    } else {
-                        linkedTo = ::std::filesystem::canonical(
-                            searchDir.parent_path() / linkedTo);
-                    }
-                    if (linkedTo == target) {
-                        printf("%s\n", searchDir.c_str());
-                        return;
-                    }
-                } catch (::std::filesystem::filesystem_error &e) {
-                    fprintf(stderr, "%s\n", e.what());
+    ::std::unordered_map<::std::string_view, OldDir> oldDirs;
+
+    // Load old index.
+    if (old != nullptr) {
+        old->forEachDir([&](::std::string_view                      path,
+                            const ::findlink::LinkIndex::DirRecord &record)
+                            -> void { oldDirs[path].record = &record; });
+        for (auto &[path, dir] : oldDirs) {
+            auto pos = path.rfind('/');
+            if (path.size() > 1 && pos != ::std::string_view::npos) {
+                auto iter = oldDirs.find(path.substr(0, pos == 0 ? 1 : pos));
+                if (iter != oldDirs.end()) {
+                    iter->second.children.push_back(path.substr(pos + 1));
                 }
-            } else {
-                return;
             }
         }
+        old->forEachLink([&](::std::string_view link, ::std::string_view raw,
+                             ::std::string_view) -> void {
+            auto pos  = link.rfind('/');
+            auto iter = oldDirs.find(link.substr(0, pos == 0 ? 1 : pos));
+            if (iter != oldDirs.end()) {
+                iter->second.links.emplace_back(link.substr(pos + 1),
+                                                ::std::string(raw));
+            }
+        });
+    }
 
-        // Search directory.
-        try {
-            for (auto &entry :
-                 ::std::filesystem::directory_iterator(searchDir)) {
-                try {
-                    if (entry.is_symlink()) {
-                        // Check.
-                        auto linkedTo
-                            = ::std::filesystem::read_symlink(entry.path());
-
-                        if (linkedTo.is_absolute()) {
-                            linkedTo = ::std::filesystem::canonical(linkedTo);
-                        } else {
-                            linkedTo = ::std::filesystem::canonical(searchDir
-                                                                    / linkedTo);
-                        }
-                        if (linkedTo == target) {
-                            printf("%s\n", entry.path().c_str());
-                            return;
-                        }
-                    } else if (entry.is_directory()
-                               && entry.path().filename() != "."
-                               && entry.path().filename() != "..") {
-                        // Add new task.
-                        ::std::unique_lock<::std::mutex> lock(queueLock);
-                        taskQueue.push(::std::make_unique<SearchTask>(
-                            ::std::ref(target), entry.path()));
-                        queueCond.notify_one();
-                    }
-                } catch (::std::filesystem::filesystem_error &e) {
-                    fprintf(stderr, "%s\n", e.what());
+    // Unresolved links are kept to resolve them again on refresh.
+    auto         search = options.search;
+    CommandStats stats(options, search);
+    search.reportUnresolved = true;
+    ::findlink::Searcher           searcher({}, ::std::move(search));
+    ::findlink::LinkIndex::Builder builder;
+
+    try {
+        searcher.traverse(
+            searchDir,
+            [&](const ::findlink::Searcher::Link &link) -> bool {
+                builder.add(link.path(), ::std::string(link.raw),
+                            ::std::string(link.linkedTo));
+                return true;
+            },
+            printError,
+            [&](const ::std::string &dir, const struct stat &st,
+                const ::findlink::Searcher::PushDirFunc &pushDir,
+                const ::findlink::Searcher::AddLinkFunc &addLink) -> bool {
+                builder.addDir(dir, st);
+
+                // Reuse unchanged directories.
+                auto iter = oldDirs.find(dir);
+                if (iter == oldDirs.end()
+                    || ! iter->second.record->unchanged(st)) {
+                    return false;
                 }
-            }
-        } catch (::std::filesystem::filesystem_error &e) {
+                for (auto &child : iter->second.children) {
+                    pushDir(child);
+                }
+                for (auto &[name, raw] : iter->second.links) {
+                    addLink(name, raw);
+                }
+                return true;
+            },
+            [&](const ::std::string &dir) -> void {
+                builder.addFailedDir(dir);
+            });
+    } catch (::std::filesystem::filesystem_error &e) {
+        printError(e);
+        return 1;
+    }
+
+    try {
+        builder.write(indexPath, searchDir);
+    } catch (::std::system_error &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       Query link index.
+ *
+ * @param[in]   indexPath   Path of index file.
+ * @param[in]   targets     Link targets, need not exist anymore.
+ * @param[in]   options     Command options.
+ *
+ * @return      Exit code.
+ */
+int doIndexQuery(const ::std::filesystem::path                &indexPath,
+                 const ::std::vector<::std::filesystem::path> &targets,
+                 const CommandOptions                         &options)
+{
+    ::findlink::OutputSink   output(STDOUT_FILENO, options.null ? '\0' : '\n');
+    ::findlink::RecordWriter writer(output, options.format,
+                                    targets.size() > 1);
+    ::std::size_t found = 0;
+    try {
+        ::findlink::LinkIndex index(indexPath);
+        for (auto &target : targets) {
+            index.query(
+                target.native(), options.search.under,
+                [&](::std::string_view link, ::std::string_view raw,
+                    ::std::string_view linkedTo) -> void {
+                    if (reportResult(options, found)) {
+                        writer.writeLink(::findlink::RecordWriter::Link {
+                            link, raw, linkedTo, target.native(), 0, 0});
+                    }
+                });
+        }
+    } catch (::std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return flushOutput(output, 1);
+    }
+
+    return flushOutput(output, options.quiet && found == 0 ? 1 : 0);
+}
+
+/**
+ * @brief       Index sub command.
+ *
+ * @param[in]   argc        Count of positional arguments.
+ * @param[in]   argv        Positional arguments, begin with the action.
+ * @param[in]   fileTargets Targets read from file.
+ * @param[in]   options     Command options.
+ * @param[in]   name        Command name.
+ *
+ * @return      Exit code.
+ */
+int indexMain(int                                 argc,
+              char                               *argv[],
+              const ::std::vector<::std::string> &fileTargets,
+              const CommandOptions               &options,
+              const char                         *name)
+{
+    if (argc == 0) {
+        fprintf(stderr, "Missing argumet \"ACTION\".\n");
+        usage(name);
+        return 1;
+    } else if (argc == 1) {
+        fprintf(stderr, "Missing argumet \"INDEX\".\n");
+        usage(name);
+        return 1;
+    }
+    ::std::filesystem::path indexPath = argv[1];
+
+    if (strcmp(argv[0], "refresh") == 0) {
+        if (argc > 2) {
+            fprintf(stderr, "Too much arguments.\n");
+            usage(name);
+            return 1;
+        }
+
+        try {
+            ::findlink::LinkIndex   old(indexPath);
+            ::std::filesystem::path searchDir(old.root());
+            return doIndexBuild(indexPath, searchDir, options, &old);
+        } catch (::std::exception &e) {
             fprintf(stderr, "%s\n", e.what());
+            return 1;
         }
-    };
 
-    // Search thread.
-    ::std::atomic<uint64_t> runningCount
-        = ::std::thread::hardware_concurrency();
-    auto searchThreadFunc = [&]() -> void {
-        while (true) {
-            // Get task.
-            ::std::unique_ptr<SearchTask> task;
-            {
-                ::std::unique_lock<::std::mutex> lock(queueLock);
-                if (taskQueue.size() > 0) {
-                    task = ::std::move(taskQueue.front());
-                    taskQueue.pop();
-                } else {
-                    --runningCount;
-                    if (runningCount == 0) {
-                        queueCond.notify_one();
-                        return;
-                    } else {
-                        queueCond.wait(lock);
-                        ++runningCount;
-                        continue;
+    } else if (strcmp(argv[0], "build") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Missing argumet \"SEARCH_DIR\".\n");
+            usage(name);
+            return 1;
+        } else if (argc > 3) {
+            fprintf(stderr, "Too much arguments.\n");
+            usage(name);
+            return 1;
+        }
+
+        ::std::error_code ec;
+        auto searchDir = ::std::filesystem::canonical(argv[2], ec);
+        if (ec) {
+            fprintf(stderr, "\"%s\" does not exists.\n", argv[2]);
+            return 1;
+        }
+
+        return doIndexBuild(indexPath, searchDir, options);
+
+    } else if (strcmp(argv[0], "query") == 0) {
+        // Links in index may point to targets removed after building.
+        ::std::vector<::std::filesystem::path> targets;
+        for (auto &target : fileTargets) {
+            targets.push_back(::std::filesystem::weakly_canonical(target));
+        }
+        for (int i = 2; i < argc; ++i) {
+            targets.push_back(::std::filesystem::weakly_canonical(argv[i]));
+        }
+        if (targets.empty()) {
+            fprintf(stderr, "Missing argumet \"TARGET\".\n");
+            usage(name);
+            return 1;
+        }
+
+        return doIndexQuery(indexPath, targets, options);
+    }
+
+    fprintf(stderr, "Unknow action \"%s\".\n", argv[0]);
+    usage(name);
+    return 1;
+}
+
+/**
+ * @brief       Serve queries of links.
+ *
+ * @param[in]   socketPath  Path of socket.
+ * @param[in]   searchDir   Search directory.
+ * @param[in]   options     Command options.
+ *
+ * @return      Exit code.
+ */
+int doDaemonServe(const ::std::filesystem::path &socketPath,
+                  const ::std::filesystem::path &searchDir,
+                  const CommandOptions          &options)
+{
+    auto         search = options.search;
+    CommandStats stats(options, search);
+    try {
+        ::findlink::LinkDaemon daemon(searchDir, search, printError);
+        daemon.serve(socketPath);
+    } catch (::std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       Query link daemon.
+ *
+ * @param[in]   socketPath  Path of socket.
+ * @param[in]   targets     Link targets, need not exist anymore.
+ * @param[in]   options     Command options.
+ *
+ * @return      Exit code.
+ */
+int doDaemonQuery(const ::std::filesystem::path                &socketPath,
+                  const ::std::vector<::std::filesystem::path> &targets,
+                  const CommandOptions                         &options)
+{
+    ::findlink::OutputSink   output(STDOUT_FILENO, options.null ? '\0' : '\n');
+    ::findlink::RecordWriter writer(output, options.format,
+                                    targets.size() > 1);
+    ::std::size_t found = 0;
+    try {
+        ::findlink::LinkDaemon::Client client(socketPath);
+        for (auto &target : targets) {
+            client.query(
+                target.native(), options.search.under,
+                [&](::std::string_view link, ::std::string_view raw,
+                    ::std::string_view linkedTo) -> void {
+                    if (reportResult(options, found)) {
+                        writer.writeLink(::findlink::RecordWriter::Link {
+                            link, raw, linkedTo, target.native(), 0, 0});
                     }
+                });
+        }
+    } catch (::std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return flushOutput(output, 1);
+    }
+
+    return flushOutput(output, options.quiet && found == 0 ? 1 : 0);
+}
+
+/**
+ * @brief       Daemon sub command.
+ *
+ * @param[in]   argc        Count of positional arguments.
+ * @param[in]   argv        Positional arguments, begin with the action.
+ * @param[in]   fileTargets Targets read from file.
+ * @param[in]   options     Command options.
+ * @param[in]   name        Command name.
+ *
+ * @return      Exit code.
+ */
+int daemonMain(int                                 argc,
+               char                               *argv[],
+               const ::std::vector<::std::string> &fileTargets,
+               const CommandOptions               &options,
+               const char                         *name)
+{
+    if (argc == 0) {
+        fprintf(stderr, "Missing argumet \"ACTION\".\n");
+        usage(name);
+        return 1;
+    } else if (argc == 1) {
+        fprintf(stderr, "Missing argumet \"SOCKET\".\n");
+        usage(name);
+        return 1;
+    }
+    ::std::filesystem::path socketPath = argv[1];
+
+    if (strcmp(argv[0], "serve") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Missing argumet \"SEARCH_DIR\".\n");
+            usage(name);
+            return 1;
+        } else if (argc > 3) {
+            fprintf(stderr, "Too much arguments.\n");
+            usage(name);
+            return 1;
+        }
+
+        ::std::error_code ec;
+        auto searchDir = ::std::filesystem::canonical(argv[2], ec);
+        if (ec) {
+            fprintf(stderr, "\"%s\" does not exists.\n", argv[2]);
+            return 1;
+        }
+
+        return doDaemonServe(socketPath, searchDir, options);
+
+    } else if (strcmp(argv[0], "query") == 0) {
+        ::std::vector<::std::filesystem::path> targets;
+        for (auto &target : fileTargets) {
+            targets.push_back(::std::filesystem::weakly_canonical(target));
+        }
+        for (int i = 2; i < argc; ++i) {
+            targets.push_back(::std::filesystem::weakly_canonical(argv[i]));
+        }
+        if (targets.empty()) {
+            fprintf(stderr, "Missing argumet \"TARGET\".\n");
+            usage(name);
+            return 1;
+        }
+
+        return doDaemonQuery(socketPath, targets, options);
+    }
+
+    fprintf(stderr, "Unknow action \"%s\".\n", argv[0]);
+    usage(name);
+    return 1;
+}
+
+/**
+ * @brief       Coordinate a search over workers.
+ *
+ * @param[in]   port        Port or service name.
+ * @param[in]   targets     Link targets.
+ * @param[in]   searchDir   Search directory.
+ * @param[in]   options     Command options.
+ *
+ * @return      Exit code.
+ */
+int doClusterCoordinate(const ::std::string           &port,
+                        ::findlink::TargetSet          targets,
+                        const ::std::filesystem::path &searchDir,
+                        const CommandOptions          &options)
+{
+    ::findlink::OutputSink   output(STDOUT_FILENO, options.null ? '\0' : '\n');
+    ::findlink::RecordWriter writer(
+        output, options.format,
+        targets.size() + options.search.targetGlobs.size() > 1);
+    ::findlink::Searcher searcher(::std::move(targets), options.search);
+
+    ::std::size_t found = 0;
+    try {
+        ::findlink::ClusterCoordinator coordinator(
+            searcher, searchDir, options.secret,
+            [&](const ::findlink::RecordWriter::Link &link) -> void {
+                if (reportResult(options, found)) {
+                    writer.writeLink(link);
                 }
+            },
+            [&](::std::string_view path, int err,
+                ::std::string_view message) -> void {
+                writer.writeError(path, err, message);
+            });
+        fprintf(stderr, "Waiting for workers on port %s, %zu units.\n",
+                port.c_str(), coordinator.unitCount());
+        coordinator.run(options.bindAddress, port);
+    } catch (::std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return flushOutput(output, 1);
+    }
+
+    return flushOutput(output, options.quiet && found == 0 ? 1 : 0);
+}
+
+/**
+ * @brief       Cluster sub command.
+ *
+ * @param[in]   argc        Count of positional arguments.
+ * @param[in]   argv        Positional arguments, begin with the action.
+ * @param[in]   fileTargets Targets read from file.
+ * @param[in]   options     Command options.
+ * @param[in]   name        Command name.
+ *
+ * @return      Exit code.
+ */
+int clusterMain(int                                 argc,
+                char                               *argv[],
+                const ::std::vector<::std::string> &fileTargets,
+                const CommandOptions               &options,
+                const char                         *name)
+{
+    if (argc == 0) {
+        fprintf(stderr, "Missing argumet \"ACTION\".\n");
+        usage(name);
+        return 1;
+    } else if (options.secret.empty()) {
+        fprintf(stderr, "Missing option \"--secret-file\".\n");
+        usage(name);
+        return 1;
+    }
+
+    if (strcmp(argv[0], "coordinate") == 0) {
+        if (argc == 1) {
+            fprintf(stderr, "Missing argumet \"PORT\".\n");
+            usage(name);
+            return 1;
+        } else if (argc == 2
+                   || (argc == 3 && fileTargets.empty()
+                       && options.search.targetGlobs.empty())) {
+            fprintf(stderr, "Missing argumet \"SEARCH_DIR\".\n");
+            usage(name);
+            return 1;
+        }
+
+        ::findlink::TargetSet targets;
+        for (auto &target : fileTargets) {
+            addTarget(targets, target);
+        }
+        for (int i = 2; i < argc - 1; ++i) {
+            if (! addTarget(targets, argv[i])) {
+                return 1;
             }
+        }
+        if (targets.empty() && options.search.targetGlobs.empty()) {
+            fprintf(stderr, "No target to search.\n");
+            return 1;
+        }
 
-            // Search.
-            searchTaskFunc(task->target, task->searchDir);
+        ::std::error_code ec;
+        auto searchDir = ::std::filesystem::canonical(argv[argc - 1], ec);
+        if (ec) {
+            fprintf(stderr, "\"%s\" does not exists.\n", argv[argc - 1]);
+            return 1;
         }
-    };
 
-    // Add first task.
-    taskQueue.push(
-        ::std::make_unique<SearchTask>(::std::ref(target), searchDir));
+        auto coordinateOptions = options;
+        addTargetDevs(coordinateOptions, targets);
 
-    // Create threads.
-    ::std::vector<::std::thread> threads;
-    for (auto i = ::std::thread::hardware_concurrency(); i > 0; --i) {
-        threads.push_back(::std::thread(searchThreadFunc));
-    }
+        return doClusterCoordinate(argv[1], ::std::move(targets), searchDir,
+                                   coordinateOptions);
+
+    } else if (strcmp(argv[0], "worker") == 0) {
+        if (argc < 2) {
+            fprintf(stderr, "Missing argumet \"HOST\".\n");
+            usage(name);
+            return 1;
+        } else if (argc < 3) {
+            fprintf(stderr, "Missing argumet \"PORT\".\n");
+            usage(name);
+            return 1;
+        } else if (argc > 3) {
+            fprintf(stderr, "Too much arguments.\n");
+            usage(name);
+            return 1;
+        }
+
+        // A coordinator gone is reported by send() instead.
+        signal(SIGPIPE, SIG_IGN);
+        auto         search = options.search;
+        CommandStats stats(options, search);
+        try {
+            ::findlink::ClusterWorker(search, options.secret)
+                .run(argv[1], argv[2]);
+        } catch (::std::exception &e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
 
-    // Join.
-    for (auto iter = threads.rbegin(); iter != threads.rend(); ++iter) {
-        iter->join();
+        return 0;
     }
 
-    return 0;
+    fprintf(stderr, "Unknow action \"%s\".\n", argv[0]);
+    usage(name);
+    return 1;
 }
 
 /**
@@ -180,17 +1112,226 @@ int doSearch(const ::std::filesystem::path &target,
  */
 int main(int argc, char *argv[])
 {
+    // Sub command.
+    bool indexMode   = (argc > 1 && strcmp(argv[1], "index") == 0);
+    bool daemonMode  = (argc > 1 && strcmp(argv[1], "daemon") == 0);
+    bool clusterMode = (argc > 1 && strcmp(argv[1], "cluster") == 0);
+    if (indexMode || daemonMode || clusterMode) {
+        optind = 2;
+    }
+
     // Parse arguments.
-    struct option longOpts[]
-        = {{"help", 0, nullptr, 'h'}, {nullptr, 0, nullptr, 0}};
+    enum LongOnlyOption {
+        OPT_MAX_THREADS = 0x100,
+        OPT_ENGINE,
+        OPT_TARGETS_FROM,
+        OPT_UNDER,
+        OPT_MAX_MEMORY,
+        OPT_EXCLUDE,
+        OPT_VISIT_ONCE,
+        OPT_DEDUP_LINKS,
+        OPT_FORMAT,
+        OPT_STATS,
+        OPT_STATS_FILE,
+        OPT_FIRST,
+        OPT_MAX_RESULTS,
+        OPT_IGNORE_MOUNTS,
+        OPT_PRUNE_BY_TARGET_DEV,
+        OPT_TARGET_GLOB,
+        OPT_PROGRESS,
+        OPT_TRACE_SUMMARY,
+        OPT_TRACE,
+        OPT_BIND,
+        OPT_SECRET_FILE,
+    };
+    struct option longOpts[] = {{"help", 0, nullptr, 'h'},
+                                {"threads", 1, nullptr, 'j'},
+                                {"max-threads", 1, nullptr, OPT_MAX_THREADS},
+                                {"engine", 1, nullptr, OPT_ENGINE},
+                                {"targets-from", 1, nullptr, OPT_TARGETS_FROM},
+                                {"under", 0, nullptr, OPT_UNDER},
+                                {"null", 0, nullptr, '0'},
+                                {"max-memory", 1, nullptr, OPT_MAX_MEMORY},
+                                {"one-file-system", 0, nullptr, 'x'},
+                                {"exclude", 1, nullptr, OPT_EXCLUDE},
+                                {"visit-once", 0, nullptr, OPT_VISIT_ONCE},
+                                {"dedup-links", 0, nullptr, OPT_DEDUP_LINKS},
+                                {"format", 1, nullptr, OPT_FORMAT},
+                                {"stats", 0, nullptr, OPT_STATS},
+                                {"stats-file", 1, nullptr, OPT_STATS_FILE},
+                                {"progress", 0, nullptr, OPT_PROGRESS},
+                                {"trace-summary", 0, nullptr,
+                                 OPT_TRACE_SUMMARY},
+                                {"trace", 1, nullptr, OPT_TRACE},
+                                {"first", 0, nullptr, OPT_FIRST},
+                                {"max-results", 1, nullptr, OPT_MAX_RESULTS},
+                                {"quiet", 0, nullptr, 'q'},
+                                {"ignore-mounts", 1, nullptr,
+                                 OPT_IGNORE_MOUNTS},
+                                {"prune-by-target-dev", 0, nullptr,
+                                 OPT_PRUNE_BY_TARGET_DEV},
+                                {"target-glob", 1, nullptr, OPT_TARGET_GLOB},
+                                {"bind", 1, nullptr, OPT_BIND},
+                                {"secret-file", 1, nullptr, OPT_SECRET_FILE},
+                                {nullptr, 0, nullptr, 0}};
 
-    int opt;
-    while ((opt = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+    CommandOptions               options;
+    ::std::vector<::std::string> fileTargets;
+    bool                         growAuto    = false;
+    bool                         targetsFrom = false;
+    int                          opt;
+    while ((opt = getopt_long(argc, argv, "hj:0xq", longOpts, nullptr)) != -1) {
         switch (opt) {
             case 'h':
                 usage(argv[0]);
                 return 0;
 
+            case 'j':
+                if (! parseThreadCount(optarg, options.search.threadCount)) {
+                    fprintf(stderr, "Illegal thread count \"%s\".\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case OPT_MAX_THREADS:
+                if (! parseThreadCount(optarg, options.search.maxThreadCount)) {
+                    fprintf(stderr, "Illegal thread count \"%s\".\n", optarg);
+                    return 1;
+                }
+                growAuto = (options.search.maxThreadCount == 0);
+                break;
+
+            case OPT_ENGINE:
+                if (strcmp(optarg, "threads") == 0) {
+                    options.search.engine = ::findlink::SearchEngine::THREADS;
+                } else if (strcmp(optarg, "uring") == 0) {
+                    options.search.engine = ::findlink::SearchEngine::URING;
+                } else {
+                    fprintf(stderr, "Unknow engine \"%s\".\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case OPT_TARGETS_FROM:
+                if (! loadTargets(fileTargets, optarg)) {
+                    return 1;
+                }
+                targetsFrom = true;
+                break;
+
+            case OPT_TARGET_GLOB:
+                options.search.targetGlobs.push_back(optarg);
+                targetsFrom = true;
+                break;
+
+            case OPT_UNDER:
+                options.search.under = true;
+                break;
+
+            case '0':
+                options.null = true;
+                break;
+
+            case OPT_MAX_MEMORY: {
+                ::std::size_t size;
+                if (! parseMemorySize(optarg, size)) {
+                    fprintf(stderr, "Illegal memory size \"%s\".\n", optarg);
+                    return 1;
+                }
+                options.search.maxPending
+                    = ::std::max<::std::size_t>(size / PENDING_DIR_COST, 1);
+            } break;
+
+            case 'x':
+                options.search.oneFileSystem = true;
+                break;
+
+            case OPT_EXCLUDE:
+                options.search.excludes.push_back(optarg);
+                break;
+
+            case OPT_VISIT_ONCE:
+                options.search.visitOnce = true;
+                break;
+
+            case OPT_DEDUP_LINKS:
+                options.search.dedupLinks = true;
+                break;
+
+            case OPT_IGNORE_MOUNTS:
+                if (! loadIgnoredMounts(options.search, optarg)) {
+                    return 1;
+                }
+                break;
+
+            case OPT_PRUNE_BY_TARGET_DEV:
+                options.pruneByTargetDev = true;
+                break;
+
+            case OPT_STATS:
+                options.stats = true;
+                break;
+
+            case OPT_STATS_FILE:
+                options.statsFile = optarg;
+                break;
+
+            case OPT_PROGRESS:
+                options.progress = true;
+                break;
+
+            case OPT_TRACE_SUMMARY:
+                options.traceSummary = true;
+                break;
+
+            case OPT_TRACE:
+                options.traceFile = optarg;
+                break;
+
+            case OPT_FIRST:
+                options.maxResults = 1;
+                break;
+
+            case OPT_MAX_RESULTS: {
+                char *end;
+                errno      = 0;
+                auto value = strtoull(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || value == 0
+                    || value > SIZE_MAX) {
+                    fprintf(stderr, "Illegal result count \"%s\".\n", optarg);
+                    return 1;
+                }
+                options.maxResults = static_cast<::std::size_t>(value);
+            } break;
+
+            case 'q':
+                options.quiet      = true;
+                options.maxResults = 1;
+                break;
+
+            case OPT_BIND:
+                options.bindAddress = optarg;
+                break;
+
+            case OPT_SECRET_FILE:
+                if (! loadSecret(options.secret, optarg)) {
+                    return 1;
+                }
+                break;
+
+            case OPT_FORMAT:
+                if (strcmp(optarg, "text") == 0) {
+                    options.format = ::findlink::RecordWriter::Format::TEXT;
+                } else if (strcmp(optarg, "jsonl") == 0) {
+                    options.format = ::findlink::RecordWriter::Format::JSONL;
+                } else if (strcmp(optarg, "binary") == 0) {
+                    options.format = ::findlink::RecordWriter::Format::BINARY;
+                } else {
+                    fprintf(stderr, "Unknow format \"%s\".\n", optarg);
+                    return 1;
+                }
+                break;
+
             default:
                 fprintf(stderr, "Unknow option.\n");
                 usage(argv[0]);
@@ -198,29 +1339,59 @@ int main(int argc, char *argv[])
         }
     }
 
-    ::std::filesystem::path target;
-    ::std::filesystem::path searchDir;
-    switch (argc - optind) {
-        case 0:
-            fprintf(stderr, "Missing argumet \"TARGET\".\n");
-            usage(argv[0]);
-            return 1u;
+    if (growAuto) {
+        options.search.maxThreadCount = ::findlink::availableCpuCount() * 8;
+    }
+    if (options.search.engine == ::findlink::SearchEngine::URING
+        && ! ::findlink::UringEngine::supported()) {
+        fprintf(stderr, "io_uring is not supported, fallback to threads.\n");
+        options.search.engine = ::findlink::SearchEngine::THREADS;
+    }
+    if (! ::findlink::Tracer::ENABLED
+        && (options.traceSummary || ! options.traceFile.empty())) {
+        fprintf(stderr, "Tracing is not compiled in, configure with "
+                        "-DENABLE_TRACING=ON.\n");
+        return 1;
+    }
 
-        case 1:
-            fprintf(stderr, "Missing argumet \"SEARCH_DIR\".\n");
-            usage(argv[0]);
-            return 1;
+    int positional = argc - optind;
+    if (indexMode) {
+        return indexMain(positional, argv + optind, fileTargets, options,
+                         argv[0]);
+    } else if (daemonMode) {
+        return daemonMain(positional, argv + optind, fileTargets, options,
+                          argv[0]);
+    } else if (clusterMode) {
+        return clusterMain(positional, argv + optind, fileTargets, options,
+                           argv[0]);
+    }
 
-        case 2:
-            target    = ::std::filesystem::canonical(argv[optind]);
-            searchDir = ::std::filesystem::canonical(argv[optind + 1]);
-            break;
+    if (positional == 0 && ! targetsFrom) {
+        fprintf(stderr, "Missing argumet \"TARGET\".\n");
+        usage(argv[0]);
+        return 1;
+    } else if (positional == 0 || (positional == 1 && ! targetsFrom)) {
+        fprintf(stderr, "Missing argumet \"SEARCH_DIR\".\n");
+        usage(argv[0]);
+        return 1;
+    }
 
-        default:
-            fprintf(stderr, "Too much arguments.\n");
-            usage(argv[0]);
+    // Targets cannot be found are skipped if read from file.
+    ::findlink::TargetSet targets;
+    for (auto &target : fileTargets) {
+        addTarget(targets, target);
+    }
+    for (int i = optind; i < argc - 1; ++i) {
+        if (! addTarget(targets, argv[i])) {
             return 1;
+        }
+    }
+    if (targets.empty() && options.search.targetGlobs.empty()) {
+        fprintf(stderr, "No target to search.\n");
+        return 1;
     }
+    addTargetDevs(options, targets);
+    auto searchDir = ::std::filesystem::canonical(argv[argc - 1]);
 
-    return doSearch(target, searchDir);
+    return doSearch(::std::move(targets), searchDir, options);
 }
@@ -0,0 +1,135 @@
+#include <cerrno>
+
+#include <unistd.h>
+
+#include <findlink/output_sink.h>
+
+namespace findlink {
+
+/**
+ * @brief       Constructor.
+ */
+OutputSink::OutputSink(int fd, char terminator) :
+    m_fd(fd), m_terminator(terminator), m_perRecord(::isatty(fd) != 0),
+    m_error(0), m_stop(false)
+{
+    if (m_perRecord) {
+        return;
+    }
+
+    m_thread = ::std::thread([this]() -> void {
+        ::std::unique_lock<::std::mutex> lock(m_stopLock);
+        while (! m_cond.wait_for(lock, FLUSH_INTERVAL,
+                                 [this]() -> bool { return m_stop; })) {
+            lock.unlock();
+            this->flush();
+            lock.lock();
+        }
+    });
+}
+
+/**
+ * @brief       Destructor, stop flush thread and flush all buffers.
+ */
+OutputSink::~OutputSink()
+{
+    if (m_thread.joinable()) {
+        {
+            ::std::unique_lock<::std::mutex> lock(m_stopLock);
+            m_stop = true;
+            m_cond.notify_all();
+        }
+        m_thread.join();
+    }
+
+    this->flush();
+}
+
+/**
+ * @brief       Write record, thread safe.
+ */
+void OutputSink::write(::std::string_view record)
+{
+    auto                            &buffer = this->local();
+    ::std::unique_lock<::std::mutex> lock(buffer.lock);
+    buffer.data.append(record);
+    buffer.data.push_back(m_terminator);
+    this->commit(buffer);
+}
+
+/**
+ * @brief       Write record of two fields separated by tab, thread safe.
+ */
+void OutputSink::write(::std::string_view first, ::std::string_view second)
+{
+    auto                            &buffer = this->local();
+    ::std::unique_lock<::std::mutex> lock(buffer.lock);
+    buffer.data.append(first);
+    buffer.data.push_back('\t');
+    buffer.data.append(second);
+    buffer.data.push_back(m_terminator);
+    this->commit(buffer);
+}
+
+/**
+ * @brief       Write a whole encoded record without terminator, thread safe.
+ */
+void OutputSink::writeRaw(::std::string_view data)
+{
+    auto                            &buffer = this->local();
+    ::std::unique_lock<::std::mutex> lock(buffer.lock);
+    buffer.data.append(data);
+    this->commit(buffer);
+}
+
+/**
+ * @brief       Flush buffers of all threads, thread safe.
+ */
+void OutputSink::flush()
+{
+    ::std::vector<Buffer *> buffers;
+    m_buffers.forEach([&](Buffer &buffer) -> void {
+        buffers.push_back(&buffer);
+    });
+    for (auto buffer : buffers) {
+        ::std::unique_lock<::std::mutex> lock(buffer->lock);
+        if (! buffer->data.empty()) {
+            this->writeOut(*buffer);
+        }
+    }
+}
+
+/**
+ * @brief       Get buffer of current thread.
+ */
+OutputSink::Buffer &OutputSink::local()
+{
+    return m_buffers.local([](Buffer &buffer, ::std::size_t) -> void {
+        buffer.data.reserve(BUFFER_SIZE + BUFFER_SIZE / 4);
+    });
+}
+
+/**
+ * @brief       Write buffer to fd and clear it, the buffer must be locked.
+ */
+void OutputSink::writeOut(Buffer &buffer)
+{
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    auto                             p    = buffer.data.data();
+    auto                             size = buffer.data.size();
+    while (size > 0 && ! this->failed()) {
+        auto ret = ::write(m_fd, p, size);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_error.store(errno, ::std::memory_order_relaxed);
+            break;
+        }
+        p += ret;
+        size -= static_cast<::std::size_t>(ret);
+    }
+    buffer.data.clear();
+}
+
+} // namespace findlink
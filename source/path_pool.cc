@@ -0,0 +1,121 @@
+#include <cstring>
+#include <new>
+
+#include <findlink/path_pool.h>
+
+namespace findlink {
+
+/**
+ * @brief       Build full path.
+ */
+void PathPool::Node::path(::std::string &path) const
+{
+    if (parent == nullptr) {
+        path.assign(this->name());
+        return;
+    }
+
+    parent->path(path);
+    if (path.size() > 1 || path[0] != '/') {
+        path.push_back('/');
+    }
+    path.append(this->name());
+}
+
+/**
+ * @brief       Constructor.
+ */
+PathPool::Local::Local(PathPool &pool) :
+    m_pool(&pool), m_next(nullptr), m_end(nullptr)
+{
+    m_free.fill(nullptr);
+}
+
+/**
+ * @brief       Create node, the node holds a reference of its parent.
+ */
+PathPool::Node *PathPool::Local::create(Node *parent, ::std::string_view name)
+{
+    auto size      = sizeof(Node) + name.size();
+    auto sizeClass = (size + GRANULARITY - 1) / GRANULARITY - 1;
+
+    void *memory;
+    if (sizeClass < SIZE_CLASSES) {
+        memory = this->allocate(sizeClass);
+    } else {
+        memory = m_pool->allocateBlock(size);
+    }
+
+    auto node       = new (memory) Node;
+    node->parent    = parent;
+    node->nameSize  = static_cast<uint32_t>(name.size());
+    node->sizeClass = static_cast<uint32_t>(sizeClass);
+    node->refs.store(1, ::std::memory_order_relaxed);
+    ::memcpy(reinterpret_cast<char *>(node + 1), name.data(), name.size());
+    if (parent != nullptr) {
+        parent->refs.fetch_add(1, ::std::memory_order_relaxed);
+    }
+
+    return node;
+}
+
+/**
+ * @brief       Release a reference of node, free the node and its ancestors
+ *              not referenced anymore.
+ */
+void PathPool::Local::release(Node *node)
+{
+    while (node != nullptr
+           && node->refs.fetch_sub(1, ::std::memory_order_acq_rel) == 1) {
+        auto parent    = node->parent;
+        auto sizeClass = node->sizeClass;
+        node->~Node();
+
+        // Large nodes are kept in their blocks until the pool is destroyed.
+        if (sizeClass < SIZE_CLASSES) {
+            auto freed        = reinterpret_cast<Node **>(node);
+            *freed            = m_free[sizeClass];
+            m_free[sizeClass] = reinterpret_cast<Node *>(freed);
+        }
+        node = parent;
+    }
+}
+
+/**
+ * @brief       Allocate memory.
+ */
+void *PathPool::Local::allocate(::std::size_t sizeClass)
+{
+    // Free list.
+    auto freed = m_free[sizeClass];
+    if (freed != nullptr) {
+        m_free[sizeClass] = *reinterpret_cast<Node **>(freed);
+        return freed;
+    }
+
+    // Current block.
+    auto size = (sizeClass + 1) * GRANULARITY;
+    if (static_cast<::std::size_t>(m_end - m_next) < size) {
+        m_next = m_pool->allocateBlock(BLOCK_SIZE);
+        m_end  = m_next + BLOCK_SIZE;
+    }
+    auto ret = m_next;
+    m_next += size;
+
+    return ret;
+}
+
+/**
+ * @brief       Allocate block, thread safe.
+ */
+char *PathPool::allocateBlock(::std::size_t size)
+{
+    ::std::unique_ptr<char[]>        block(new char[size]);
+    auto                             ret = block.get();
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    m_blocks.push_back(::std::move(block));
+
+    return ret;
+}
+
+} // namespace findlink
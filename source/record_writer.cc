@@ -0,0 +1,211 @@
+#include <cstdio>
+#include <cstring>
+
+#include <findlink/record_writer.h>
+
+namespace findlink {
+
+namespace {
+
+/// Record being encoded by current thread.
+thread_local ::std::string localRecord;
+
+/**
+ * @brief       Append JSON field name.
+ *
+ * @param[out]  out         Output.
+ * @param[in]   name        Field name.
+ */
+inline void appendJsonName(::std::string &out, const char *name)
+{
+    out.push_back(out.size() > 1 ? ',' : '{');
+    out.push_back('"');
+    out.append(name);
+    out.append("\":");
+}
+
+/**
+ * @brief       Append plain value in host byte order.
+ *
+ * @param[out]  out         Output.
+ * @param[in]   value       Value.
+ */
+template<typename T>
+inline void appendBinary(::std::string &out, T value)
+{
+    char buffer[sizeof(T)];
+    ::memcpy(buffer, &value, sizeof(T));
+    out.append(buffer, sizeof(T));
+}
+
+/**
+ * @brief       Append length-prefixed binary string.
+ *
+ * @param[out]  out         Output.
+ * @param[in]   str         String.
+ */
+inline void appendBinaryString(::std::string &out, ::std::string_view str)
+{
+    appendBinary(out, static_cast<uint32_t>(str.size()));
+    out.append(str);
+}
+
+/**
+ * @brief       Begin binary record.
+ *
+ * @param[out]  out         Output.
+ * @param[in]   type        Record type.
+ */
+inline void beginBinary(::std::string &out, char type)
+{
+    out.push_back(type);
+    appendBinary(out, static_cast<uint32_t>(0));
+}
+
+/**
+ * @brief       End binary record, fill size of record.
+ *
+ * @param[out]  out         Output.
+ */
+inline void endBinary(::std::string &out)
+{
+    auto size = static_cast<uint32_t>(out.size() - 1 - sizeof(uint32_t));
+    ::memcpy(out.data() + 1, &size, sizeof(size));
+}
+
+} // namespace
+
+/**
+ * @brief       Append JSON string.
+ *
+ * @param[out]  out         Output.
+ * @param[in]   str         String.
+ */
+void appendJsonString(::std::string &out, ::std::string_view str)
+{
+    static const char HEX[] = "0123456789abcdef";
+
+    out.push_back('"');
+    for (char c : str) {
+        auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (byte < 0x20) {
+            out.append("\\u00");
+            out.push_back(HEX[byte >> 4]);
+            out.push_back(HEX[byte & 0xF]);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+/**
+ * @brief       Constructor.
+ */
+RecordWriter::RecordWriter(OutputSink &output, Format format, bool tagged) :
+    m_output(output), m_format(format), m_tagged(tagged)
+{}
+
+/**
+ * @brief       Write link found, thread safe.
+ */
+void RecordWriter::writeLink(const Link &link)
+{
+    auto &record = localRecord;
+    record.clear();
+    switch (m_format) {
+        case Format::TEXT:
+            if (m_tagged) {
+                m_output.write(link.path, link.matched);
+            } else {
+                m_output.write(link.path);
+            }
+            return;
+
+        case Format::JSONL:
+            appendJsonName(record, "type");
+            record.append("\"link\"");
+            appendJsonName(record, "link");
+            appendJsonString(record, link.path);
+            appendJsonName(record, "raw");
+            appendJsonString(record, link.raw);
+            appendJsonName(record, "target");
+            appendJsonString(record, link.target);
+            appendJsonName(record, "matched");
+            appendJsonString(record, link.matched);
+            appendJsonName(record, "dev");
+            record.append(::std::to_string(link.dev));
+            appendJsonName(record, "ino");
+            record.append(::std::to_string(link.ino));
+            record.append("}\n");
+            break;
+
+        case Format::BINARY:
+            beginBinary(record, 'L');
+            appendBinaryString(record, link.path);
+            appendBinaryString(record, link.raw);
+            appendBinaryString(record, link.target);
+            appendBinaryString(record, link.matched);
+            appendBinary(record, link.dev);
+            appendBinary(record, link.ino);
+            endBinary(record);
+            break;
+    }
+
+    m_output.writeRaw(record);
+}
+
+/**
+ * @brief       Write error, thread safe.
+ */
+void RecordWriter::writeError(const ::std::filesystem::filesystem_error &e)
+{
+    this->writeError(e.path1().native(), e.code().value(), e.what());
+}
+
+/**
+ * @brief       Write error by its fields, thread safe.
+ */
+void RecordWriter::writeError(::std::string_view path,
+                              int                err,
+                              ::std::string_view message)
+{
+    auto       &record = localRecord;
+    const char *kind   = ::strerrorname_np(err);
+    record.clear();
+    switch (m_format) {
+        case Format::TEXT:
+            fprintf(stderr, "%.*s\n", static_cast<int>(message.size()),
+                    message.data());
+            return;
+
+        case Format::JSONL:
+            appendJsonName(record, "type");
+            record.append("\"error\"");
+            appendJsonName(record, "path");
+            appendJsonString(record, path);
+            appendJsonName(record, "errno");
+            record.append(::std::to_string(err));
+            appendJsonName(record, "kind");
+            appendJsonString(record, kind == nullptr ? "EUNKNOWN" : kind);
+            appendJsonName(record, "message");
+            appendJsonString(record, message);
+            record.append("}\n");
+            break;
+
+        case Format::BINARY:
+            beginBinary(record, 'E');
+            appendBinaryString(record, path);
+            appendBinary(record, static_cast<int32_t>(err));
+            appendBinaryString(record, message);
+            endBinary(record);
+            break;
+    }
+
+    m_output.writeRaw(record);
+}
+
+} // namespace findlink
@@ -0,0 +1,656 @@
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <findlink/cpu_count.h>
+#include <findlink/dir_filter.h>
+#include <findlink/dir_scanner.h>
+#include <findlink/link_resolver.h>
+#include <findlink/path_pool.h>
+#include <findlink/scheduler.h>
+#include <findlink/searcher.h>
+#include <findlink/target_matcher.h>
+#include <findlink/tracer.h>
+#include <findlink/uring_engine.h>
+#include <findlink/visited_set.h>
+
+namespace findlink {
+
+namespace {
+
+/// Requests in flight of io_uring engine.
+constexpr unsigned int URING_DEPTH = 256;
+
+/// Maximum depth of directories scanned at once in bounded mode.
+constexpr unsigned int MAX_INLINE_DEPTH = 64;
+
+/**
+ * @brief       Join directory and name.
+ *
+ * @param[in]   dir         Directory.
+ * @param[in]   name        Name.
+ *
+ * @return      Path.
+ */
+::std::string joinPath(::std::string_view dir, ::std::string_view name)
+{
+    ::std::string ret;
+    ret.reserve(dir.size() + name.size() + 1);
+    ret.append(dir);
+    if (ret.size() > 1 || ret[0] != '/') {
+        ret.push_back('/');
+    }
+    ret.append(name);
+
+    return ret;
+}
+
+} // namespace
+
+/**
+ * @brief       Get path of link.
+ */
+::std::string Searcher::Link::path() const
+{
+    return joinPath(this->dir, this->name);
+}
+
+/**
+ * @brief       Constructor.
+ */
+Searcher::Searcher(TargetSet targets, SearchOptions options) :
+    m_targets(::std::move(targets)), m_options(::std::move(options))
+{}
+
+/**
+ * @brief       Search links pointing to the targets.
+ */
+void Searcher::search(const ::std::filesystem::path &searchDir,
+                      const MatchFunc               &onMatch,
+                      const ErrorFunc               &onError,
+                      CancelFlag                    *cancel) const
+{
+    auto stats      = m_options.stats;
+    auto searchWith = [&](const auto &matcher) -> void {
+        this->traverseWith(
+            searchDir,
+            [&](const Link &link) -> bool {
+                if (link.linkedTo.empty()) {
+                    return true;
+                }
+                auto matched = matcher(link.linkedTo);
+                if (matched) {
+                    if (stats != nullptr) {
+                        Stats::add(stats->local().matched);
+                    }
+                    Link found    = link;
+                    found.matched = *matched;
+                    return onMatch(found);
+                }
+                return true;
+            },
+            onError, nullptr, nullptr, cancel);
+    };
+
+    // Dispatch once to the kernel of the matcher.
+    if (! m_options.targetGlobs.empty()) {
+        searchWith(
+            GlobMatcher(m_targets, m_options.targetGlobs, m_options.under));
+    } else if (m_targets.size() == 1) {
+        if (m_options.under) {
+            searchWith(SingleUnderMatcher(m_targets));
+        } else {
+            searchWith(SingleTargetMatcher(m_targets));
+        }
+    } else if (m_options.under) {
+        searchWith(TargetSetUnderMatcher(m_targets));
+    } else {
+        searchWith(TargetSetMatcher(m_targets));
+    }
+}
+
+/**
+ * @brief       Traverse directory and resolve all links.
+ */
+void Searcher::traverse(const ::std::filesystem::path &searchDir,
+                        const LinkFunc                &onLink,
+                        const ErrorFunc               &onError,
+                        const DirFunc                 &onDir,
+                        const DirErrorFunc            &onDirError,
+                        CancelFlag                    *cancel) const
+{
+    this->traverseWith(searchDir, onLink, onError, onDir, onDirError, cancel);
+}
+
+/**
+ * @brief       Traverse directory, instantiated on the link callback so
+ *              \c search() inlines its matcher.
+ */
+template<typename OnLink>
+void Searcher::traverseWith(const ::std::filesystem::path &searchDir,
+                            const OnLink                  &onLink,
+                            const ErrorFunc               &onError,
+                            const DirFunc                 &onDir,
+                            const DirErrorFunc            &onDirError,
+                            CancelFlag                    *cancel) const
+{
+    auto &options = m_options;
+    auto  stats   = options.stats;
+    auto  tracer  = options.tracer;
+
+    // Set by callbacks returning false, or by the caller.
+    CancelFlag localCancel(false);
+    auto      &cancelled = cancel != nullptr ? *cancel : localCancel;
+    auto       isCancelled = [&]() -> bool {
+        return cancelled.load(::std::memory_order_relaxed);
+    };
+
+    // Check root, the device is always filled.
+    struct statx rootStat;
+    if (::statx(AT_FDCWD, searchDir.c_str(), 0, STATX_TYPE, &rootStat) < 0) {
+        throw ::std::filesystem::filesystem_error(
+            "cannot stat", searchDir,
+            ::std::error_code(errno, ::std::system_category()));
+    }
+    if (! S_ISDIR(rootStat.stx_mode)) {
+        return;
+    }
+    auto rootDev = options.rootDev != 0
+                       ? options.rootDev
+                       : ::makedev(rootStat.stx_dev_major,
+                                   rootStat.stx_dev_minor);
+
+    // Directories skipped.
+    DirFilter filter;
+    for (auto &pattern : options.excludes) {
+        filter.addExclude(pattern);
+    }
+    for (auto &type : options.excludeFsTypes) {
+        filter.addFsType(type);
+    }
+    filter.addMounts(searchDir.native(), rootDev, options.oneFileSystem,
+                     options.targetDevs);
+    auto otherDev = [&](dev_t dev) -> bool {
+        if (dev == rootDev) {
+            return false;
+        }
+        auto &devs = options.targetDevs;
+        return options.oneFileSystem
+               || (! devs.empty()
+                   && ::std::find(devs.begin(), devs.end(), dev)
+                          == devs.end());
+    };
+
+    auto countError
+        = [&](const ::std::filesystem::filesystem_error &e) -> void {
+        if (stats != nullptr) {
+            stats->error(e.code().value());
+        }
+        onError(e);
+    };
+    auto dirError = [&](const ::std::string                       &dir,
+                        const ::std::filesystem::filesystem_error &e) -> void {
+        countError(e);
+        if (onDirError) {
+            onDirError(dir);
+        }
+    };
+
+    LinkResolver resolver(m_targets, stats);
+    VisitedSet     visited;
+    VisitedLinkSet visitedLinks;
+
+    // Scan directory from offset, 0 for the whole directory. The rest of a
+    // large directory is handed to splitDir, which returns false to keep it.
+    auto scanDirFunc = [&](DirScanner &scanner, off_t offset, uint64_t dev,
+                           auto &&pushDir, auto &&splitDir) -> void {
+        auto        &searchDir = scanner.path();
+        Stats::Slot *slot      = stats != nullptr ? &stats->local() : nullptr;
+        if (slot != nullptr && offset == 0) {
+            Stats::add(slot->dirs);
+        }
+
+        // Filter subdirectories before they are queued.
+        bool checkChildren = filter.checkChildren(searchDir);
+        auto pushChild     = [&](::std::string_view name) -> void {
+            if (! checkChildren || ! filter.excluded(searchDir, name)) {
+                pushDir(name);
+            }
+        };
+
+        // Directory checked by the task scanning its first batch.
+        struct stat st;
+        if (offset != 0) {
+            scanner.seek(offset);
+        } else if (onDir || options.oneFileSystem || options.visitOnce
+                   || options.statDirs || options.dedupLinks
+                   || ! options.targetDevs.empty()) {
+            if (::fstat(scanner.fd(), &st) < 0) {
+                throw ::std::filesystem::filesystem_error(
+                    "cannot stat", ::std::filesystem::path(searchDir),
+                    ::std::error_code(errno, ::std::system_category()));
+            }
+            dev = static_cast<uint64_t>(st.st_dev);
+
+            // Mounted after the mount table is read.
+            if (otherDev(st.st_dev)) {
+                return;
+            }
+
+            // Reached through another path.
+            if (options.visitOnce && ! visited.visit(st)) {
+                return;
+            }
+        }
+
+        // Directory callback.
+        if (onDir && offset == 0) {
+            auto addLink = [&](::std::string_view   name,
+                               const ::std::string &raw) -> void {
+                if (isCancelled()) {
+                    return;
+                }
+                try {
+                    auto linkedTo = resolver.resolve(searchDir, name, raw);
+                    Link link {searchDir, name, raw, linkedTo, {}, dev, 0};
+                    if (! onLink(link)) {
+                        cancelled.store(true, ::std::memory_order_relaxed);
+                    }
+                } catch (::std::filesystem::filesystem_error &e) {
+                    countError(e);
+                    if (options.reportUnresolved
+                        && ! onLink(Link {searchDir, name, raw, {}, {}, dev,
+                                          0})) {
+                        cancelled.store(true, ::std::memory_order_relaxed);
+                    }
+                }
+            };
+            if (onDir(searchDir, st, pushChild, addLink)) {
+                return;
+            }
+        }
+
+        DirScanner::Entry                   entry;
+        ::std::vector<LinkResolver::BatchLink> links;
+        while (! isCancelled() && scanner.nextBatch()) {
+            // Batches after this one are read by another task meanwhile.
+            auto end   = scanner.batchFull() ? scanner.batchEnd() : 0;
+            bool split = end != 0 && splitDir(end, dev);
+            if (slot != nullptr) {
+                Stats::add(slot->splits, split);
+            }
+
+            // Links of the batch are resolved together.
+            links.clear();
+            while (! isCancelled() && scanner.nextInBatch(entry)) {
+                try {
+                    auto type = scanner.type(entry);
+                    if (slot != nullptr) {
+                        Stats::add(slot->entries);
+                        Stats::add(slot->links, type == DT_LNK);
+                    }
+                    if (type == DT_LNK) {
+                        auto raw = traced(
+                            tracer, TraceKind::READLINK, searchDir, entry.name,
+                            [&]() { return scanner.readLink(entry); });
+                        links.push_back(LinkResolver::BatchLink {
+                            entry.name, ::std::move(raw), entry.ino, {}, {}});
+                    } else if (type == DT_DIR) {
+                        // Add new task.
+                        pushChild(entry.name);
+                    }
+                } catch (::std::filesystem::filesystem_error &e) {
+                    countError(e);
+                }
+            }
+
+            // Check.
+            traced(tracer, TraceKind::RESOLVE, searchDir, {},
+                   [&]() {
+                       resolver.resolveBatch(searchDir, scanner.fd(), links);
+                   });
+            for (auto &link : links) {
+                if (isCancelled()) {
+                    break;
+                }
+                if (link.error) {
+                    countError(*link.error);
+                    if (! options.reportUnresolved) {
+                        continue;
+                    }
+                }
+                // Reached through another path or name.
+                if (options.dedupLinks && ! link.error
+                    && ! visitedLinks.visit(dev, link.ino, link.linkedTo)) {
+                    continue;
+                }
+                if (! onLink(Link {searchDir, link.name, link.raw,
+                                   link.linkedTo, {}, dev, link.ino})) {
+                    cancelled.store(true, ::std::memory_order_relaxed);
+                }
+            }
+            if (split) {
+                break;
+            }
+        }
+    };
+
+    // Asynchronous engine.
+    if (options.engine == SearchEngine::URING && UringEngine::supported()) {
+        UringEngine engine(URING_DEPTH);
+
+        // Directories beyond the bound are opened synchronously.
+        auto uringScanFunc = [&](auto &self, DirScanner &scanner,
+                                 unsigned int depth) -> void {
+            if (isCancelled()) {
+                engine.cancel();
+                return;
+            }
+            auto pushDir = [&](::std::string_view name) -> void {
+                auto dir = joinPath(scanner.path(), name);
+                if (options.maxPending == 0
+                    || engine.pending() < options.maxPending
+                    || depth >= MAX_INLINE_DEPTH) {
+                    engine.push(::std::move(dir));
+                    return;
+                }
+
+                // On the heap, so each level keeps little stack.
+                try {
+                    auto subScanner = ::std::make_unique<DirScanner>(dir);
+                    self(self, *subScanner, depth + 1);
+                } catch (::std::filesystem::filesystem_error &e) {
+                    dirError(dir, e);
+                }
+            };
+
+            // Directories are read by a single thread, never split.
+            scanDirFunc(scanner, 0, 0, pushDir,
+                        [](off_t, uint64_t) -> bool { return false; });
+        };
+
+        engine.push(searchDir.native());
+        engine.run(
+            [&](DirScanner &scanner) -> void {
+                try {
+                    uringScanFunc(uringScanFunc, scanner, 0);
+                } catch (::std::filesystem::filesystem_error &e) {
+                    dirError(scanner.path(), e);
+                }
+            },
+            [&](const ::std::filesystem::filesystem_error &e) -> void {
+                // Only directories failed to open reach here.
+                dirError(e.path1().native(), e);
+            });
+        return;
+    }
+
+    /**
+     * @brief       Search task, a directory or the rest of a large one.
+     */
+    struct SearchTask {
+        PathPool::Node *node;   ///< Directory.
+        off_t           offset; ///< Offset to resume at, 0 for whole.
+        uint64_t        dev;    ///< Device if resumed, 0 if unknown.
+    };
+
+    // Thread pool, tasks are path nodes.
+    using TaskScheduler = Scheduler<SearchTask>;
+
+    auto cpuCount    = availableCpuCount();
+    auto threadCount = options.threadCount;
+    if (threadCount == 0) {
+        threadCount = cpuCount;
+    }
+    TaskScheduler scheduler(threadCount, options.maxThreadCount, cpuCount,
+                            stats);
+    bool splitDirs = scheduler.threadCount() > 1 || options.maxThreadCount > 1;
+
+    /**
+     * @brief       State of a worker.
+     */
+    struct alignas(64) WorkerState {
+        PathPool::Local local; ///< Node allocator.
+
+        /// Paths of directories scanning, by depth scanned at once.
+        ::std::vector<::std::string> paths;
+
+        explicit WorkerState(PathPool &pool) :
+            local(pool), paths(MAX_INLINE_DEPTH + 1)
+        {}
+    };
+    PathPool                                      pool;
+    ::std::vector<::std::unique_ptr<WorkerState>> states;
+    for (::std::size_t i = 0; i < scheduler.threadCount(); ++i) {
+        states.push_back(::std::make_unique<WorkerState>(pool));
+    }
+
+    // Search task, directories beyond the bound are scanned at once. Their
+    // scanners are on the heap, so each level keeps little stack.
+    auto searchTaskFunc = [&](auto &self, TaskScheduler::Worker &worker,
+                              const SearchTask &task, unsigned int depth,
+                              auto onHeap) -> void {
+        auto &state = *states[worker.id()];
+        auto  node  = task.node;
+        if (isCancelled()) {
+            scheduler.cancel();
+            state.local.release(node);
+            return;
+        }
+
+        auto &path = state.paths[depth];
+        node->path(path);
+        TraceScope trace(tracer, TraceKind::DIR, path);
+        try {
+            auto pushDir = [&](::std::string_view name) -> void {
+                auto child = state.local.create(node, name);
+                if (options.maxPending == 0
+                    || scheduler.queued() < options.maxPending
+                    || depth >= MAX_INLINE_DEPTH) {
+                    worker.push(SearchTask {child, 0, 0});
+                } else {
+                    self(self, worker, SearchTask {child, 0, 0}, depth + 1,
+                         ::std::true_type {});
+                }
+            };
+            auto splitDir = [&](off_t offset, uint64_t dev) -> bool {
+                if (! splitDirs) {
+                    return false;
+                }
+                state.local.retain(node);
+                worker.push(SearchTask {node, offset, dev});
+                return true;
+            };
+            if constexpr (decltype(onHeap)::value) {
+                auto scanner = ::std::make_unique<DirScanner>(path);
+                scanDirFunc(*scanner, task.offset, task.dev, pushDir,
+                            splitDir);
+            } else {
+                DirScanner scanner(path);
+                scanDirFunc(scanner, task.offset, task.dev, pushDir, splitDir);
+            }
+        } catch (::std::filesystem::filesystem_error &e) {
+            dirError(path, e);
+        }
+        if (isCancelled()) {
+            scheduler.cancel();
+        }
+        state.local.release(node);
+    };
+
+    // Add first task.
+    auto root = states[0]->local.create(nullptr, searchDir.native());
+    scheduler.push(SearchTask {root, 0, 0});
+
+    // Run.
+    scheduler.run([&](TaskScheduler::Worker &worker, SearchTask &task) -> void {
+        searchTaskFunc(searchTaskFunc, worker, task, 0, ::std::false_type {});
+    });
+}
+
+/**
+ * @brief       Get match.
+ */
+Searcher::Batch::Match Searcher::Batch::operator[](::std::size_t index) const
+{
+    auto       &entry = m_entries[index];
+    const char *data  = m_data.data() + entry.offset;
+
+    return Match {::std::string_view(data, entry.pathSize),
+                  ::std::string_view(data + entry.pathSize, entry.rawSize),
+                  ::std::string_view(data + entry.pathSize + entry.rawSize,
+                                     entry.linkedToSize),
+                  entry.matched,
+                  entry.dev,
+                  entry.ino};
+}
+
+/**
+ * @brief       Add match.
+ */
+void Searcher::Batch::add(const Link &link)
+{
+    Entry entry;
+    entry.offset = m_data.size();
+    m_data.append(link.dir);
+    if (link.dir != "/") {
+        m_data.push_back('/');
+    }
+    m_data.append(link.name);
+    entry.pathSize = static_cast<uint32_t>(m_data.size() - entry.offset);
+    m_data.append(link.raw);
+    entry.rawSize = static_cast<uint32_t>(link.raw.size());
+    m_data.append(link.linkedTo);
+    entry.linkedToSize = static_cast<uint32_t>(link.linkedTo.size());
+    entry.matched      = link.matched;
+    entry.dev          = link.dev;
+    entry.ino          = link.ino;
+    m_entries.push_back(entry);
+}
+
+/**
+ * @brief       Remove all matches, the buffer is kept.
+ */
+void Searcher::Batch::clear()
+{
+    m_data.clear();
+    m_entries.clear();
+}
+
+/**
+ * @brief       Constructor, start searching.
+ */
+Searcher::Results::Results(const Searcher                &searcher,
+                           const ::std::filesystem::path &searchDir,
+                           const ErrorFunc               &onError,
+                           ::std::size_t                  batchSize,
+                           ::std::size_t                  maxBatches) :
+    m_searcher(searcher), m_searchDir(searchDir), m_onError(onError),
+    m_batchSize(batchSize > 0 ? batchSize : 1),
+    m_maxBatches(maxBatches > 0 ? maxBatches : 1), m_done(false),
+    m_closed(false), m_cancel(false)
+{
+    m_thread = ::std::thread([this]() -> void {
+        ::std::exception_ptr error;
+        try {
+            m_searcher.search(
+                m_searchDir,
+                [this](const Link &link) -> bool { return this->add(link); },
+                [this](const ::std::filesystem::filesystem_error &e) -> void {
+                    if (m_onError) {
+                        m_onError(e);
+                    }
+                },
+                &m_cancel);
+        } catch (...) {
+            error = ::std::current_exception();
+        }
+
+        ::std::unique_lock<::std::mutex> lock(m_lock);
+        if (! m_current.empty()) {
+            m_batches.push_back(::std::move(m_current));
+            m_current.clear();
+        }
+        m_error = error;
+        m_done  = true;
+        m_cond.notify_all();
+    });
+}
+
+/**
+ * @brief       Destructor, stop consuming and wait for the search.
+ */
+Searcher::Results::~Results()
+{
+    {
+        ::std::unique_lock<::std::mutex> lock(m_lock);
+        m_closed = true;
+        m_batches.clear();
+        m_cancel.store(true, ::std::memory_order_relaxed);
+        m_cond.notify_all();
+    }
+    m_thread.join();
+}
+
+/**
+ * @brief       Get next batch, blocks until one is ready.
+ */
+bool Searcher::Results::next(Batch &batch)
+{
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    m_cond.wait(lock, [this]() -> bool {
+        return ! m_batches.empty() || m_done;
+    });
+
+    if (m_batches.empty()) {
+        if (m_error) {
+            ::std::rethrow_exception(::std::exchange(m_error, nullptr));
+        }
+        return false;
+    }
+
+    batch = ::std::move(m_batches.front());
+    m_batches.pop_front();
+    m_cond.notify_all();
+
+    return true;
+}
+
+/**
+ * @brief       Add match, called on traversal threads.
+ */
+bool Searcher::Results::add(const Link &link)
+{
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    if (m_closed) {
+        return false;
+    }
+
+    m_current.add(link);
+    if (m_current.size() < m_batchSize) {
+        return true;
+    }
+
+    m_cond.wait(lock, [this]() -> bool {
+        return m_batches.size() < m_maxBatches || m_closed;
+    });
+    if (m_closed) {
+        m_current.clear();
+        return false;
+    }
+    m_batches.push_back(::std::move(m_current));
+    m_current.clear();
+    m_cond.notify_all();
+
+    return true;
+}
+
+} // namespace findlink
@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <cstring>
+
+#include <findlink/stats.h>
+
+namespace findlink {
+
+namespace {
+
+/**
+ * @brief       Append "name value" line.
+ *
+ * @param[out]  out         Output.
+ * @param[in]   name        Name.
+ * @param[in]   value       Value.
+ */
+template<typename T>
+void appendLine(::std::string &out, const ::std::string &name, T value)
+{
+    out.append(name);
+    out.push_back(' ');
+    out.append(::std::to_string(value));
+    out.push_back('\n');
+}
+
+} // namespace
+
+/**
+ * @brief       Constructor.
+ */
+Stats::Stats() :
+    m_begin(Clock::now()), m_queueHighWater(0), m_queueDepth(nullptr)
+{}
+
+/**
+ * @brief       Set counter of tasks queued read by snapshots, thread safe.
+ */
+void Stats::watchQueue(const ::std::atomic<::std::size_t> *queued)
+{
+    ::std::unique_lock<::std::mutex> lock(m_lock);
+    m_queueDepth = queued;
+}
+
+/**
+ * @brief       Take snapshot, thread safe.
+ */
+Stats::Snapshot Stats::snapshot() const
+{
+    Snapshot ret;
+    ret.elapsed
+        = ::std::chrono::duration<double>(Clock::now() - m_begin).count();
+    ret.dirs            = 0;
+    ret.entries         = 0;
+    ret.splits          = 0;
+    ret.links           = 0;
+    ret.matched         = 0;
+    ret.resolveSyscalls = 0;
+    ret.prefixHits      = 0;
+    ret.linkHits        = 0;
+    ret.linkMisses      = 0;
+    ret.idleNs          = 0;
+    ret.lockWaitNs      = 0;
+    ret.steals          = 0;
+    ret.queueHighWater  = m_queueHighWater.load(::std::memory_order_relaxed);
+
+    {
+        ::std::unique_lock<::std::mutex> lock(m_lock);
+        ret.queueDepth = m_queueDepth != nullptr
+                             ? m_queueDepth->load(::std::memory_order_relaxed)
+                             : 0;
+    }
+
+    ::std::array<uint64_t, ERRNO_COUNT> errors {};
+    ret.threads = 0;
+    m_slots.forEach([&](const Slot &slot) -> void {
+        constexpr auto RELAXED = ::std::memory_order_relaxed;
+        ++ret.threads;
+        ret.dirs += slot.dirs.load(RELAXED);
+        ret.entries += slot.entries.load(RELAXED);
+        ret.splits += slot.splits.load(RELAXED);
+        ret.links += slot.links.load(RELAXED);
+        ret.matched += slot.matched.load(RELAXED);
+        ret.resolveSyscalls += slot.resolveSyscalls.load(RELAXED);
+        ret.prefixHits += slot.prefixHits.load(RELAXED);
+        ret.linkHits += slot.linkHits.load(RELAXED);
+        ret.linkMisses += slot.linkMisses.load(RELAXED);
+        ret.idleNs += slot.idleNs.load(RELAXED);
+        ret.lockWaitNs += slot.lockWaitNs.load(RELAXED);
+        ret.steals += slot.steals.load(RELAXED);
+        for (::std::size_t i = 0; i < ERRNO_COUNT; ++i) {
+            errors[i] += slot.errors[i].load(RELAXED);
+        }
+    });
+    for (::std::size_t i = 0; i < ERRNO_COUNT; ++i) {
+        if (errors[i] > 0) {
+            ret.errors.emplace_back(static_cast<int>(i), errors[i]);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Format snapshot, one "name value" per line.
+ */
+::std::string Stats::format(const Snapshot &snapshot)
+{
+    ::std::string ret;
+    appendLine(ret, "elapsed_seconds", snapshot.elapsed);
+    appendLine(ret, "threads", snapshot.threads);
+    appendLine(ret, "dirs_scanned", snapshot.dirs);
+    appendLine(ret, "entries_seen", snapshot.entries);
+    appendLine(ret, "dir_splits", snapshot.splits);
+    appendLine(ret, "links_read", snapshot.links);
+    appendLine(ret, "links_matched", snapshot.matched);
+    appendLine(ret, "resolve_syscalls", snapshot.resolveSyscalls);
+    appendLine(ret, "resolve_prefix_hits", snapshot.prefixHits);
+    appendLine(ret, "resolve_link_hits", snapshot.linkHits);
+    appendLine(ret, "resolve_link_misses", snapshot.linkMisses);
+    appendLine(ret, "queue_high_water", snapshot.queueHighWater);
+    appendLine(ret, "queue_depth", snapshot.queueDepth);
+    appendLine(ret, "steals", snapshot.steals);
+    appendLine(ret, "idle_seconds",
+               static_cast<double>(snapshot.idleNs) / 1e9);
+    appendLine(ret, "lock_wait_seconds",
+               static_cast<double>(snapshot.lockWaitNs) / 1e9);
+
+    uint64_t errors = 0;
+    for (auto &[err, count] : snapshot.errors) {
+        errors += count;
+    }
+    appendLine(ret, "errors", errors);
+    for (auto &[err, count] : snapshot.errors) {
+        auto name = err == 0 ? nullptr : ::strerrorname_np(err);
+        appendLine(ret,
+                   ::std::string("errors_")
+                       + (name == nullptr ? "OTHER" : name),
+                   count);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Format snapshot as a one line progress status.
+ */
+::std::string Stats::formatProgress(const Snapshot &snapshot,
+                                    const Snapshot &last)
+{
+    auto   interval = snapshot.elapsed - last.elapsed;
+    double rate     = 0;
+    if (interval > 0) {
+        rate = static_cast<double>(snapshot.entries - last.entries) / interval;
+    }
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "%.0fs: %llu dirs, %llu entries (%.0f/s), %llu links, "
+             "%llu matched, %llu queued",
+             snapshot.elapsed, static_cast<unsigned long long>(snapshot.dirs),
+             static_cast<unsigned long long>(snapshot.entries), rate,
+             static_cast<unsigned long long>(snapshot.links),
+             static_cast<unsigned long long>(snapshot.matched),
+             static_cast<unsigned long long>(snapshot.queueDepth));
+
+    return buffer;
+}
+
+} // namespace findlink
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <fstream>
+
+#include <unistd.h>
+
+#include <findlink/stats_reporter.h>
+
+namespace findlink {
+
+/**
+ * @brief       Constructor.
+ */
+StatsReporter::StatsReporter(Stats                         &stats,
+                             const ::std::filesystem::path &path,
+                             ::std::chrono::milliseconds    interval,
+                             bool                           print,
+                             bool                           progress) :
+    m_stats(stats), m_path(path), m_interval(interval), m_print(print),
+    m_progress(progress), m_terminal(::isatty(STDERR_FILENO) == 1),
+    m_last(stats.snapshot()), m_stop(false)
+{
+    if (m_path.empty() && ! m_progress) {
+        return;
+    }
+
+    m_thread = ::std::thread([this]() -> void {
+        ::std::unique_lock<::std::mutex> lock(m_lock);
+        while (! m_cond.wait_for(lock, m_interval,
+                                 [this]() -> bool { return m_stop; })) {
+            lock.unlock();
+            auto snapshot = m_stats.snapshot();
+            if (! m_path.empty()) {
+                this->exportFile(Stats::format(snapshot));
+            }
+            if (m_progress) {
+                this->printProgress(snapshot);
+            }
+            lock.lock();
+        }
+    });
+}
+
+/**
+ * @brief       Destructor, report last snapshot.
+ */
+StatsReporter::~StatsReporter()
+{
+    if (m_thread.joinable()) {
+        {
+            ::std::unique_lock<::std::mutex> lock(m_lock);
+            m_stop = true;
+            m_cond.notify_all();
+        }
+        m_thread.join();
+    }
+
+    auto snapshot = m_stats.snapshot();
+    auto text     = Stats::format(snapshot);
+    if (! m_path.empty()) {
+        this->exportFile(text);
+    }
+    if (m_progress) {
+        this->printProgress(snapshot);
+        if (m_terminal) {
+            fputc('\n', stderr);
+        }
+    }
+    if (m_print) {
+        fprintf(stderr, "%s", text.c_str());
+    }
+}
+
+/**
+ * @brief       Export snapshot to file.
+ */
+void StatsReporter::exportFile(const ::std::string &text)
+{
+    auto tmpPath = m_path;
+    tmpPath += ".tmp";
+    {
+        ::std::ofstream stream(tmpPath, ::std::ios::trunc);
+        stream << text;
+        if (! stream) {
+            return;
+        }
+    }
+
+    ::std::error_code ec;
+    ::std::filesystem::rename(tmpPath, m_path, ec);
+}
+
+/**
+ * @brief       Print progress status.
+ */
+void StatsReporter::printProgress(const Stats::Snapshot &snapshot)
+{
+    auto text = Stats::formatProgress(snapshot, m_last);
+    if (m_terminal) {
+        // Redraw line in place.
+        fprintf(stderr, "\r%s\033[K", text.c_str());
+    } else {
+        fprintf(stderr, "%s\n", text.c_str());
+    }
+    fflush(stderr);
+    m_last = snapshot;
+}
+
+} // namespace findlink
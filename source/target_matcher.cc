@@ -0,0 +1,29 @@
+#include <fnmatch.h>
+
+#include <findlink/target_matcher.h>
+
+namespace findlink {
+
+/**
+ * @brief       Match path.
+ */
+const ::std::string *GlobMatcher::operator()(::std::string_view path) const
+{
+    auto ret = m_under ? m_targets.findUnder(path) : m_targets.find(path);
+    if (ret != nullptr) {
+        return ret;
+    }
+
+    // fnmatch() needs a NUL-terminated path.
+    ::std::string str(path);
+    int           flags = m_under ? FNM_LEADING_DIR : 0;
+    for (auto &glob : m_globs) {
+        if (::fnmatch(glob.c_str(), str.c_str(), flags) == 0) {
+            return &glob;
+        }
+    }
+
+    return nullptr;
+}
+
+} // namespace findlink
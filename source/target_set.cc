@@ -0,0 +1,64 @@
+#include <findlink/target_set.h>
+
+namespace findlink {
+
+/**
+ * @brief       Add target.
+ */
+void TargetSet::add(const ::std::string &target)
+{
+    m_targets.insert(target);
+    if (m_lengths.size() <= target.size()) {
+        m_lengths.resize(target.size() + 1, false);
+    }
+    m_lengths[target.size()] = true;
+
+    // Ancestors.
+    auto pos = target.rfind('/');
+    while (pos != ::std::string::npos && pos > 0) {
+        if (! m_ancestors.emplace(target.substr(0, pos)).second) {
+            // Ancestors of this one are added too.
+            return;
+        }
+        pos = target.rfind('/', pos - 1);
+    }
+}
+
+/**
+ * @brief       Find the deepest target which is the path itself or one of its
+ *              ancestors.
+ */
+const ::std::string *TargetSet::findUnder(::std::string_view path) const
+{
+    // Single target, compare bytes directly.
+    if (m_targets.size() == 1) {
+        auto &target = *m_targets.begin();
+        return isPathPrefix(path, target) ? &target : nullptr;
+    }
+
+    // Probe the path and each ancestor which has the length of a target.
+    if (path.size() < m_lengths.size() && m_lengths[path.size()]) {
+        auto ret = this->find(path);
+        if (ret) {
+            return ret;
+        }
+    }
+    auto pos = path.size();
+    while (pos > 0) {
+        pos = path.rfind('/', pos - 1);
+        if (pos == ::std::string_view::npos) {
+            break;
+        }
+        auto size = (pos == 0 ? 1 : pos);
+        if (size < m_lengths.size() && m_lengths[size]) {
+            auto ret = this->find(path.substr(0, size));
+            if (ret) {
+                return ret;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+} // namespace findlink
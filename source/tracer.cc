@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#include <unistd.h>
+
+#include <findlink/record_writer.h>
+#include <findlink/tracer.h>
+
+namespace findlink {
+
+namespace {
+
+/// Names of operations.
+const char *const KIND_NAMES[Tracer::KIND_COUNT] = {"dir", "readlink",
+                                                    "resolve"};
+
+/// Percentiles of summary.
+const ::std::pair<const char *, double> PERCENTILES[] = {
+    {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p99.9", 0.999}};
+
+/**
+ * @brief       Compare events by duration, for a min-heap.
+ *
+ * @param[in]   a           Event.
+ * @param[in]   b           Event.
+ *
+ * @return      \c true if \c a is slower.
+ */
+bool slower(const Tracer::Event &a, const Tracer::Event &b)
+{
+    return a.duration > b.duration;
+}
+
+/**
+ * @brief       Format duration.
+ *
+ * @param[in]   ns          Nanoseconds.
+ *
+ * @return      Text.
+ */
+::std::string formatDuration(uint64_t ns)
+{
+    char buffer[32];
+    if (ns < 1000000) {
+        snprintf(buffer, sizeof(buffer), "%.1fus",
+                 static_cast<double>(ns) / 1e3);
+    } else if (ns < 1000000000) {
+        snprintf(buffer, sizeof(buffer), "%.1fms",
+                 static_cast<double>(ns) / 1e6);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%.2fs",
+                 static_cast<double>(ns) / 1e9);
+    }
+
+    return buffer;
+}
+
+} // namespace
+
+/**
+ * @brief       Add value.
+ */
+void Tracer::Histogram::add(uint64_t value)
+{
+    // Values below 2 ^ SUB_BITS have exact buckets.
+    ::std::size_t index = value;
+    if (value >= (1u << SUB_BITS)) {
+        unsigned int exponent = 63 - __builtin_clzll(value);
+        unsigned int shift    = exponent - SUB_BITS;
+        index = (static_cast<::std::size_t>(shift + 1) << SUB_BITS)
+                + ((value >> shift) & ((1u << SUB_BITS) - 1));
+    }
+
+    ++m_buckets[index];
+    ++m_count;
+    m_sum += value;
+    m_max = ::std::max(m_max, value);
+}
+
+/**
+ * @brief       Add values of another histogram.
+ */
+void Tracer::Histogram::merge(const Histogram &other)
+{
+    for (::std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = ::std::max(m_max, other.m_max);
+}
+
+/**
+ * @brief       Get percentile.
+ */
+uint64_t Tracer::Histogram::percentile(double quantile) const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+
+    auto     rank = static_cast<uint64_t>(quantile * (m_count - 1)) + 1;
+    uint64_t seen = 0;
+    for (::std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i];
+        if (seen < rank) {
+            continue;
+        }
+        if (i < (1u << SUB_BITS)) {
+            return i;
+        }
+        // Middle of bucket, buckets are 2 ^ shift wide.
+        uint64_t shift = (i >> SUB_BITS) - 1;
+        uint64_t sub   = i & ((1u << SUB_BITS) - 1);
+        uint64_t low   = ((uint64_t(1) << SUB_BITS) + sub) << shift;
+        return ::std::min(low + (uint64_t(1) << shift) / 2, m_max);
+    }
+
+    return m_max;
+}
+
+/**
+ * @brief       Constructor.
+ */
+Tracer::Tracer(::std::size_t topCount, ::std::chrono::nanoseconds eventMin) :
+    m_begin(Clock::now()), m_topCount(topCount), m_eventMin(eventMin)
+{}
+
+/**
+ * @brief       Record operation of current thread.
+ */
+void Tracer::record(TraceKind          kind,
+                    ::std::string_view dir,
+                    ::std::string_view name,
+                    Clock::time_point  begin)
+{
+    using ::std::chrono::nanoseconds;
+    auto  duration = static_cast<uint64_t>(
+        ::std::chrono::duration_cast<nanoseconds>(Clock::now() - begin)
+            .count());
+    auto &slot     = this->local();
+    slot.histograms[static_cast<::std::size_t>(kind)].add(duration);
+
+    bool top = kind == TraceKind::DIR
+               && (slot.slowest.size() < m_topCount
+                   || (m_topCount > 0
+                       && duration > slot.slowest.front().duration));
+    bool event = duration >= static_cast<uint64_t>(m_eventMin.count())
+                 && slot.events.size() < MAX_EVENTS;
+    if (! top && ! event) {
+        return;
+    }
+
+    // Path is only built for operations kept.
+    auto  offset = ::std::chrono::duration_cast<nanoseconds>(begin - m_begin);
+    Event record {::std::string(dir), kind,
+                  static_cast<uint64_t>(offset.count()), duration,
+                  slot.thread};
+    if (! name.empty()) {
+        if (record.name.size() > 1 || record.name[0] != '/') {
+            record.name.push_back('/');
+        }
+        record.name.append(name);
+    }
+    if (event) {
+        slot.events.push_back(record);
+    }
+    if (top) {
+        if (slot.slowest.size() == m_topCount) {
+            ::std::pop_heap(slot.slowest.begin(), slot.slowest.end(), slower);
+            slot.slowest.pop_back();
+        }
+        slot.slowest.push_back(::std::move(record));
+        ::std::push_heap(slot.slowest.begin(), slot.slowest.end(), slower);
+    }
+}
+
+/**
+ * @brief       Format latency histograms and slowest directories.
+ */
+::std::string Tracer::summary() const
+{
+    ::std::array<Histogram, KIND_COUNT> histograms;
+    ::std::vector<Event>                slowest;
+    m_slots.forEach([&](const Slot &slot) -> void {
+        for (::std::size_t i = 0; i < KIND_COUNT; ++i) {
+            histograms[i].merge(slot.histograms[i]);
+        }
+        slowest.insert(slowest.end(), slot.slowest.begin(),
+                       slot.slowest.end());
+    });
+
+    ::std::string ret;
+    for (::std::size_t i = 0; i < KIND_COUNT; ++i) {
+        auto &histogram = histograms[i];
+        char  buffer[64];
+        snprintf(buffer, sizeof(buffer), "%-8s count %llu", KIND_NAMES[i],
+                 static_cast<unsigned long long>(histogram.count()));
+        ret.append(buffer);
+        ret.append(", mean ").append(formatDuration(histogram.mean()));
+        for (auto [name, quantile] : PERCENTILES) {
+            ret.append(", ").append(name).push_back(' ');
+            ret.append(formatDuration(histogram.percentile(quantile)));
+        }
+        ret.append(", max ").append(formatDuration(histogram.max()));
+        ret.push_back('\n');
+    }
+
+    // Merge slowest of all threads.
+    ::std::sort(slowest.begin(), slowest.end(), slower);
+    if (slowest.size() > m_topCount) {
+        slowest.resize(m_topCount);
+    }
+    if (! slowest.empty()) {
+        ret.append("slowest directories:\n");
+    }
+    for (auto &event : slowest) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%10s  ",
+                 formatDuration(event.duration).c_str());
+        ret.append(buffer).append(event.name).push_back('\n');
+    }
+
+    return ret;
+}
+
+/**
+ * @brief       Write events as a Chrome trace-event JSON file.
+ */
+bool Tracer::writeTrace(const ::std::filesystem::path &path) const
+{
+    ::std::ofstream stream(path, ::std::ios::trunc);
+    if (! stream) {
+        return false;
+    }
+
+    // Complete events, times in microseconds.
+    auto          pid = static_cast<long>(::getpid());
+    ::std::string record;
+    bool          first = true;
+    stream << "{\"traceEvents\":[";
+    m_slots.forEach([&](const Slot &slot) -> void {
+        for (auto &event : slot.events) {
+            char buffer[160];
+            snprintf(buffer, sizeof(buffer),
+                     ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                     "\"pid\":%ld,\"tid\":%u}",
+                     KIND_NAMES[static_cast<::std::size_t>(event.kind)],
+                     static_cast<double>(event.begin) / 1e3,
+                     static_cast<double>(event.duration) / 1e3, pid,
+                     event.thread);
+            record.assign(first ? "\n{\"name\":" : ",\n{\"name\":");
+            appendJsonString(record, event.name);
+            record.append(buffer);
+            stream << record;
+            first = false;
+        }
+    });
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return static_cast<bool>(stream);
+}
+
+/**
+ * @brief       Get slot of current thread.
+ */
+Tracer::Slot &Tracer::local()
+{
+    return m_slots.local([](Slot &slot, ::std::size_t index) -> void {
+        slot.thread = static_cast<uint32_t>(index);
+    });
+}
+
+} // namespace findlink
@@ -0,0 +1,305 @@
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <findlink/uring_engine.h>
+
+namespace findlink {
+
+namespace {
+
+/**
+ * @brief       io_uring_setup syscall.
+ */
+inline int ioUringSetup(unsigned int entries, io_uring_params *params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+/**
+ * @brief       io_uring_enter syscall.
+ */
+inline int ioUringEnter(int          fd,
+                        unsigned int toSubmit,
+                        unsigned int minComplete,
+                        unsigned int flags)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit,
+                                      minComplete, flags, nullptr, 0));
+}
+
+/**
+ * @brief       io_uring_register syscall.
+ */
+inline int ioUringRegister(int          fd,
+                           unsigned int opcode,
+                           void        *arg,
+                           unsigned int count)
+{
+    return static_cast<int>(
+        ::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+/**
+ * @brief       Get pointer at offset of mapped ring.
+ */
+template<typename T>
+inline T *ringPtr(void *ring, __u32 offset)
+{
+    return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+} // namespace
+
+/**
+ * @brief       Check if the kernel supports the engine.
+ */
+bool UringEngine::supported()
+{
+    io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+    int fd = ioUringSetup(2, &params);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Probe opcodes.
+    constexpr unsigned int OPS_COUNT = IORING_OP_LAST;
+    auto                   size      = sizeof(io_uring_probe)
+                     + OPS_COUNT * sizeof(io_uring_probe_op);
+    ::std::unique_ptr<char[]> buffer(new char[size]());
+    auto probe = reinterpret_cast<io_uring_probe *>(buffer.get());
+
+    bool ret = false;
+    if (ioUringRegister(fd, IORING_REGISTER_PROBE, probe, OPS_COUNT) == 0) {
+        ret = probe->last_op >= IORING_OP_OPENAT
+              && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED);
+    }
+    ::close(fd);
+
+    return ret;
+}
+
+/**
+ * @brief       Constructor.
+ */
+UringEngine::UringEngine(unsigned int depth) :
+    m_ringFd(-1), m_depth(depth), m_inFlight(0), m_sqRing(MAP_FAILED),
+    m_sqRingSize(0), m_sqes(static_cast<io_uring_sqe *>(MAP_FAILED)),
+    m_sqesSize(0), m_toSubmit(0), m_cqRing(MAP_FAILED), m_cqRingSize(0),
+    m_cancelled(false)
+{
+    io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+    m_ringFd = ioUringSetup(depth, &params);
+    if (m_ringFd < 0) {
+        throw ::std::system_error(errno, ::std::system_category(),
+                                  "io_uring_setup");
+    }
+    if (m_depth > params.sq_entries) {
+        m_depth = params.sq_entries;
+    }
+
+    // Map rings.
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(__u32);
+    m_cqRingSize
+        = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (m_cqRingSize > m_sqRingSize) {
+            m_sqRingSize = m_cqRingSize;
+        }
+        m_cqRingSize = m_sqRingSize;
+    }
+
+    m_sqRing = ::mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED) {
+        int err = errno;
+        this->release();
+        throw ::std::system_error(err, ::std::system_category(), "mmap");
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_cqRing = m_sqRing;
+    } else {
+        m_cqRing
+            = ::mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_CQ_RING);
+        if (m_cqRing == MAP_FAILED) {
+            int err = errno;
+            this->release();
+            throw ::std::system_error(err, ::std::system_category(), "mmap");
+        }
+    }
+
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes     = static_cast<io_uring_sqe *>(
+        ::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES));
+    if (m_sqes == MAP_FAILED) {
+        int err = errno;
+        this->release();
+        throw ::std::system_error(err, ::std::system_category(), "mmap");
+    }
+
+    m_sqHead  = ringPtr<unsigned int>(m_sqRing, params.sq_off.head);
+    m_sqTail  = ringPtr<unsigned int>(m_sqRing, params.sq_off.tail);
+    m_sqMask  = ringPtr<unsigned int>(m_sqRing, params.sq_off.ring_mask);
+    m_sqArray = ringPtr<unsigned int>(m_sqRing, params.sq_off.array);
+    m_cqHead  = ringPtr<unsigned int>(m_cqRing, params.cq_off.head);
+    m_cqTail  = ringPtr<unsigned int>(m_cqRing, params.cq_off.tail);
+    m_cqMask  = ringPtr<unsigned int>(m_cqRing, params.cq_off.ring_mask);
+    m_cqes    = ringPtr<io_uring_cqe>(m_cqRing, params.cq_off.cqes);
+}
+
+/**
+ * @brief       Destructor.
+ */
+UringEngine::~UringEngine()
+{
+    this->release();
+}
+
+/**
+ * @brief       Release ring.
+ */
+void UringEngine::release()
+{
+    if (m_sqes != MAP_FAILED) {
+        ::munmap(m_sqes, m_sqesSize);
+        m_sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    }
+    if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) {
+        ::munmap(m_cqRing, m_cqRingSize);
+    }
+    m_cqRing = MAP_FAILED;
+    if (m_sqRing != MAP_FAILED) {
+        ::munmap(m_sqRing, m_sqRingSize);
+        m_sqRing = MAP_FAILED;
+    }
+    if (m_ringFd >= 0) {
+        ::close(m_ringFd);
+        m_ringFd = -1;
+    }
+}
+
+/**
+ * @brief       Add directory to scan.
+ */
+void UringEngine::push(::std::string dir)
+{
+    if (! m_cancelled.load(::std::memory_order_relaxed)) {
+        m_pending.push_back(::std::move(dir));
+    }
+}
+
+/**
+ * @brief       Run until all directories are scanned.
+ */
+void UringEngine::run(const ScanFunc &scan, const ErrorFunc &error)
+{
+    while (! m_pending.empty() || m_inFlight > 0) {
+        if (m_cancelled.load(::std::memory_order_relaxed)) {
+            m_pending.clear();
+        }
+        this->queueOpens();
+        this->submit(true);
+
+        // Reap completions.
+        unsigned int head = *m_cqHead;
+        unsigned int tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            auto &cqe = m_cqes[head & *m_cqMask];
+            ::std::unique_ptr<::std::string> dir(
+                reinterpret_cast<::std::string *>(cqe.user_data));
+            int res = cqe.res;
+            ++head;
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+            --m_inFlight;
+
+            if (m_cancelled.load(::std::memory_order_relaxed)) {
+                if (res >= 0) {
+                    ::close(res);
+                }
+                continue;
+            } else if (res < 0) {
+                error(::std::filesystem::filesystem_error(
+                    "cannot open directory", ::std::filesystem::path(*dir),
+                    ::std::error_code(-res, ::std::system_category())));
+                continue;
+            }
+
+            try {
+                DirScanner scanner(res, *dir);
+                scan(scanner);
+            } catch (::std::filesystem::filesystem_error &e) {
+                error(e);
+            }
+
+            // New directories may be pushed by scan, keep the ring busy.
+            this->queueOpens();
+            if (m_toSubmit >= SUBMIT_BATCH) {
+                this->submit(false);
+            }
+            tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        }
+    }
+}
+
+/**
+ * @brief       Queue open requests of pending directories.
+ */
+void UringEngine::queueOpens()
+{
+    unsigned int tail = *m_sqTail;
+    while (! m_pending.empty() && m_inFlight < m_depth) {
+        auto dir = ::std::make_unique<::std::string>(
+            ::std::move(m_pending.back()));
+        m_pending.pop_back();
+
+        unsigned int index = tail & *m_sqMask;
+        auto        &sqe   = m_sqes[index];
+        ::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode     = IORING_OP_OPENAT;
+        sqe.fd         = AT_FDCWD;
+        sqe.addr       = reinterpret_cast<__u64>(dir->c_str());
+        sqe.open_flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+        sqe.user_data  = reinterpret_cast<__u64>(dir.release());
+        m_sqArray[index] = index;
+
+        ++tail;
+        ++m_toSubmit;
+        ++m_inFlight;
+    }
+    __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief       Submit queued requests.
+ */
+void UringEngine::submit(bool wait)
+{
+    if (m_inFlight == 0) {
+        return;
+    }
+
+    while (true) {
+        int ret = ioUringEnter(m_ringFd, m_toSubmit, wait ? 1 : 0,
+                               wait ? IORING_ENTER_GETEVENTS : 0);
+        if (ret >= 0) {
+            m_toSubmit -= static_cast<unsigned int>(ret);
+            return;
+        } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            throw ::std::system_error(errno, ::std::system_category(),
+                                      "io_uring_enter");
+        }
+    }
+}
+
+} // namespace findlink